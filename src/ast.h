@@ -0,0 +1,107 @@
+#ifndef AST_H
+#define AST_H
+
+#include "core/core.h"
+
+struct SourceLocation {
+  u32 line;
+  u32 column;
+  usize offset;
+  // Index of the input file, as passed to parse_file.
+  u32 file;
+};
+
+// Error reporting
+struct ParseError {
+  str8 message;
+  SourceLocation location;
+};
+
+struct ErrorList {
+  ParseError *errors;
+  usize count;
+  usize capacity;
+};
+
+void add_error(ErrorList *errors, str8 message, SourceLocation location);
+
+enum TypeKind {
+  TYPE_UNRESOLVED,
+  TYPE_BUILTIN,
+  TYPE_STRUCT,
+  TYPE_FLAGS,
+};
+
+// Filled in by the semantic pass; `index` points into the builtin table, or
+// into ParseResult::structs / ParseResult::flags.
+struct TypeRef {
+  TypeKind kind;
+  u32 index;
+};
+
+struct FieldDecl {
+  str8 type_name;
+  str8 field_name;
+  SourceLocation location;
+  TypeRef type;
+};
+
+struct StructDecl {
+  str8 name;
+  FieldDecl *fields;
+  usize field_count;
+  str8 *generators;
+  usize generator_count;
+  SourceLocation location;
+};
+
+struct FlagsDecl {
+  str8 name;
+  str8 *members;
+  usize member_count;
+  str8 *generators;
+  usize generator_count;
+  SourceLocation location;
+};
+
+struct ParseResult {
+  StructDecl *structs;
+  usize struct_count;
+  FlagsDecl *flags;
+  usize flags_count;
+  ErrorList errors;
+};
+
+// Declarations point into `input`; the arrays inside them live in `arena`.
+// The top-level arrays of the result are heap allocated, see
+// parse_result_free.
+ParseResult parse_file(Arena *arena, str8 input, u32 file = 0);
+// Same result as parse_file, with the input cut into up to `thread_count`
+// chunks at top-level declarations that are lexed and parsed concurrently.
+ParseResult parse_file_parallel(Arena *arena, str8 input, u32 file,
+                                u32 thread_count);
+
+// Receives declarations from parse_stream as they complete. Everything in a
+// declaration, including its strings, lives in `arena` and is released when
+// the callback returns.
+struct DeclSink {
+  void *user;
+  void (*on_struct)(void *user, Arena *arena, StructDecl *decl);
+  void (*on_flags)(void *user, Arena *arena, FlagsDecl *decl);
+};
+
+// Parses the file at `path` while reading it, one top-level declaration at a
+// time, so memory use is bounded by the largest declaration rather than the
+// file. Declarations are delivered in source order and errors are appended
+// to `errors`. Returns false if the file cannot be read.
+bool parse_stream(Arena *arena, const char *path, u32 file, DeclSink *sink,
+                  ErrorList *errors);
+
+// Moves the declarations and errors of `from` to the end of `into`, so
+// several files can be analyzed as one schema.
+void parse_result_append(ParseResult *into, ParseResult *from);
+// Frees the top-level arrays; the declarations' own arrays go with the arena
+// they were parsed into.
+void parse_result_free(ParseResult *result);
+
+#endif
@@ -32,11 +32,14 @@ void arena_release(Arena *arena) {
 void *arena_push(Arena *arena, usize size, u64 align) {
   usize pos = ALIGN_UP(arena->pos, align);
   if (pos + size > arena->commited) {
-    CHECK(arena->commited + arena->commit_size <= arena->reserved,
+    usize missing = pos + size - arena->commited;
+    usize grow = (missing + arena->commit_size - 1) / arena->commit_size *
+                 arena->commit_size;
+    CHECK(arena->commited + grow <= arena->reserved,
           "Arena out of memory: not enough reserved space");
 
-    os_commit(arena + arena->commited, arena->commit_size);
-    arena->commited += arena->commit_size;
+    os_commit((u8 *)arena + arena->commited, grow);
+    arena->commited += grow;
   }
 
   void *ptr = (void *)((u8 *)arena + pos);
@@ -9,6 +9,7 @@
 
 #define KB(x) ((x) * 1024)
 #define MB(x) ((x) * 1024 * 1024)
+#define GB(x) ((x) * 1024ull * 1024 * 1024)
 
 #define UNUSED(x) ((void)(x))
 
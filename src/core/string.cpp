@@ -46,6 +46,16 @@ Cut str8_cut(str8 str, u8 c) {
   return {str8_span(str, 0, i), str8_span(str, i)};
 }
 
+// FNV-1a
+u64 str8_hash(str8 str) {
+  u64 h = 0xCBF29CE484222325ull;
+  for (usize i = 0; i < str.len; i++) {
+    h ^= str.data[i];
+    h *= 0x100000001B3ull;
+  }
+  return h;
+}
+
 parsed_float parse_float(str8 s) {
   float r = 0.0f;
   float sign = 1.0f;
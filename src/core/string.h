@@ -4,6 +4,7 @@
 
 #include "arena.h"
 #include "base.h"
+#include <cstdarg>
 #include <string_view>
 
 struct str8 {
@@ -56,6 +57,14 @@ struct str8_builder {
   char *build_cstr() { return (char *)build(true).data; }
 };
 
+ALWAYS_INLINE str8 str8_copy(Arena *arena, str8 str) {
+  u8 *data = (u8 *)arena_push(arena, str.len, 1);
+  if (str.len) {
+    std::memcpy(data, str.data, str.len);
+  }
+  return {data, str.len};
+}
+
 ALWAYS_INLINE char *str8_to_cstr(Arena *arena, str8 str) {
   str8_builder builder(arena);
   builder.append(str);
@@ -69,6 +78,8 @@ struct Cut {
 
 Cut str8_cut(str8 str, u8 c);
 
+u64 str8_hash(str8 str);
+
 inline str8 str8_span(str8 str, usize start) {
   CHECK(start <= str.len, "Invalid span: start=%zu, len=%zu", start, str.len);
   return {str.data + start, str.len - start};
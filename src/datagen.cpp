@@ -1,7 +1,12 @@
+#include "ast.h"
 #include "core/core.h"
+#include "gen/gen.h"
+#include "os/os.h"
+#include "sema.h"
 #include <cctype>
 #include <stdio.h>
 #include <stdlib.h>
+#include <thread>
 
 // Token types
 enum TokenType {
@@ -19,12 +24,6 @@ enum TokenType {
   TOKEN_ERROR
 };
 
-struct SourceLocation {
-  u32 line;
-  u32 column;
-  usize offset;
-};
-
 struct Token {
   TokenType type;
   str8 value;
@@ -36,50 +35,7 @@ struct Lexer {
   usize pos;
   u32 line;
   u32 column;
-};
-
-// Error reporting
-struct ParseError {
-  str8 message;
-  SourceLocation location;
-};
-
-struct ErrorList {
-  ParseError *errors;
-  usize count;
-  usize capacity;
-};
-
-struct FieldDecl {
-  str8 type_name;
-  str8 field_name;
-  SourceLocation location;
-};
-
-struct StructDecl {
-  str8 name;
-  FieldDecl *fields;
-  usize field_count;
-  char **generators;
-  usize generator_count;
-  SourceLocation location;
-};
-
-struct FlagsDecl {
-  char *name;
-  char **members;
-  usize member_count;
-  char **generators;
-  usize generator_count;
-  SourceLocation location;
-};
-
-struct ParseResult {
-  StructDecl *structs;
-  usize struct_count;
-  FlagsDecl *flags;
-  usize flags_count;
-  ErrorList errors;
+  u32 file;
 };
 
 struct Parser {
@@ -87,6 +43,10 @@ struct Parser {
   bool has_current;
   Token current;
   ErrorList *errors;
+  // Holds the arrays inside declarations. Each array is pushed one element at
+  // a time and nothing else is pushed until it is complete, so it stays
+  // contiguous without knowing its length up front.
+  Arena *arena;
 };
 
 // Utility functions
@@ -102,7 +62,9 @@ void add_error(ErrorList *errors, str8 message, SourceLocation location) {
   errors->count++;
 }
 
-Lexer init_lexer(str8 input) { return Lexer{input, 0, 1, 1}; }
+Lexer init_lexer(str8 input, u32 file) {
+  return Lexer{input, 0, 1, 1, file};
+}
 
 str8 peek(Lexer *lexer) {
   if (lexer->pos >= lexer->input.len)
@@ -143,7 +105,8 @@ Token make_token(TokenType type, str8 value, SourceLocation location) {
 }
 
 Token scan_identifier(Lexer *lexer) {
-  SourceLocation location = {lexer->line, lexer->column, lexer->pos};
+  SourceLocation location = {lexer->line, lexer->column, lexer->pos,
+                             lexer->file};
   usize start = lexer->pos;
 
   str8 n;
@@ -167,7 +130,8 @@ Token scan_identifier(Lexer *lexer) {
 
 Token next_token(Lexer *lexer) {
   skip_whitespace(lexer);
-  SourceLocation location = {lexer->line, lexer->column, lexer->pos};
+  SourceLocation location = {lexer->line, lexer->column, lexer->pos,
+                             lexer->file};
   str8 c = peek(lexer);
   if (c.len == 0) {
     return make_token(TOKEN_EOF, {}, location);
@@ -202,8 +166,8 @@ Token next_token(Lexer *lexer) {
   }
 }
 
-Parser init_parser(Lexer *lexer, ErrorList *errors) {
-  return Parser{lexer, false, {}, errors};
+Parser init_parser(Lexer *lexer, ErrorList *errors, Arena *arena) {
+  return Parser{lexer, false, {}, errors, arena};
 }
 
 Token current_token(Parser *parser) {
@@ -273,11 +237,36 @@ FieldDeclRes parse_field(Parser *parser) {
           .type_name = type_token.value,
           .field_name = name_token.value,
           .location = type_token.location,
+          .type = {},
       },
       true,
   };
 }
 
+void parse_generators(Parser *parser, str8 **generators,
+                      usize *generator_count) {
+  if (expect(parser, TOKEN_LPAREN, "Expected '('"_u8).type == TOKEN_ERROR)
+    return;
+
+  *generators = arena_push<str8>(parser->arena, 0);
+  while (!check(parser, TOKEN_RPAREN) && !check(parser, TOKEN_EOF)) {
+    Token name_token =
+        expect(parser, TOKEN_IDENTIFIER, "Expected generator name"_u8);
+    if (name_token.type != TOKEN_ERROR) {
+      *arena_push<str8>(parser->arena) = name_token.value;
+      (*generator_count)++;
+    } else {
+      consume_token(parser);
+    }
+
+    if (!match(parser, TOKEN_COMMA)) {
+      break;
+    }
+  }
+
+  expect(parser, TOKEN_RPAREN, "Expected ')'"_u8);
+}
+
 struct StructDeclRes {
   StructDecl decl;
   bool success;
@@ -298,16 +287,12 @@ StructDeclRes parse_struct(Parser *parser) {
   StructDecl decl = {name_token.value, NULL, 0, NULL, 0, struct_token.location};
 
   // Parse fields
-  usize field_capacity = 0;
+  decl.fields = arena_push<FieldDecl>(parser->arena, 0);
   while (!check(parser, TOKEN_RBRACE) && !check(parser, TOKEN_EOF)) {
     FieldDeclRes field = parse_field(parser);
     if (field.success) {
-      if (decl.field_count >= field_capacity) {
-        field_capacity = field_capacity ? field_capacity * 2 : 4;
-        decl.fields = (FieldDecl *)realloc(decl.fields,
-                                           field_capacity * sizeof(FieldDecl));
-      }
-      decl.fields[decl.field_count++] = field.field;
+      *arena_push<FieldDecl>(parser->arena) = field.field;
+      decl.field_count++;
     }
 
     if (!match(parser, TOKEN_COMMA)) {
@@ -317,18 +302,64 @@ StructDeclRes parse_struct(Parser *parser) {
 
   expect(parser, TOKEN_RBRACE, "Expected '}'"_u8);
 
+  if (match(parser, TOKEN_GENERATES)) {
+    parse_generators(parser, &decl.generators, &decl.generator_count);
+  }
+
   return {decl, true};
 }
 
-ParseResult parse_file(str8 input) {
-  ParseResult result{};
+struct FlagsDeclRes {
+  FlagsDecl decl;
+  bool success;
+};
+FlagsDeclRes parse_flags(Parser *parser) {
+  Token flags_token = expect(parser, TOKEN_FLAGS, "Expected 'flags'"_u8);
+  if (flags_token.type == TOKEN_ERROR)
+    return {{}, false};
+
+  Token name_token = expect(parser, TOKEN_IDENTIFIER, "Expected flags name"_u8);
+  if (name_token.type == TOKEN_ERROR)
+    return {{}, false};
+
+  if (expect(parser, TOKEN_LBRACE, "Expected '{'"_u8).type == TOKEN_ERROR)
+    return {{}, false};
 
-  usize token_count;
-  Lexer lexer = init_lexer(input);
+  FlagsDecl decl = {name_token.value, NULL, 0, NULL, 0, flags_token.location};
 
-  Parser parser = init_parser(&lexer, &result.errors);
+  decl.members = arena_push<str8>(parser->arena, 0);
+  while (!check(parser, TOKEN_RBRACE) && !check(parser, TOKEN_EOF)) {
+    Token member_token =
+        expect(parser, TOKEN_IDENTIFIER, "Expected flag name"_u8);
+    if (member_token.type != TOKEN_ERROR) {
+      *arena_push<str8>(parser->arena) = member_token.value;
+      decl.member_count++;
+    } else {
+      synchronize_to_next_field(parser);
+      continue;
+    }
+
+    if (!match(parser, TOKEN_COMMA)) {
+      break;
+    }
+  }
+
+  expect(parser, TOKEN_RBRACE, "Expected '}'"_u8);
+
+  if (match(parser, TOKEN_GENERATES)) {
+    parse_generators(parser, &decl.generators, &decl.generator_count);
+  }
+
+  return {decl, true};
+}
+
+ParseResult parse_lexer(Arena *arena, Lexer *lexer) {
+  ParseResult result{};
+
+  Parser parser = init_parser(lexer, &result.errors, arena);
 
   usize struct_capacity = 0;
+  usize flags_capacity = 0;
 
   while (!check(&parser, TOKEN_EOF)) {
     if (check(&parser, TOKEN_STRUCT)) {
@@ -341,6 +372,16 @@ ParseResult parse_file(str8 input) {
         }
         result.structs[result.struct_count++] = decl.decl;
       }
+    } else if (check(&parser, TOKEN_FLAGS)) {
+      FlagsDeclRes decl = parse_flags(&parser);
+      if (decl.success) {
+        if (result.flags_count >= flags_capacity) {
+          flags_capacity = flags_capacity ? flags_capacity * 2 : 4;
+          result.flags = (FlagsDecl *)realloc(
+              result.flags, flags_capacity * sizeof(FlagsDecl));
+        }
+        result.flags[result.flags_count++] = decl.decl;
+      }
     } else {
       add_error(&result.errors, "Expected declaration"_u8,
                 current_token(&parser).location);
@@ -351,11 +392,328 @@ ParseResult parse_file(str8 input) {
   return result;
 }
 
-void print_errors(ErrorList *errors) {
+ParseResult parse_file(Arena *arena, str8 input, u32 file) {
+  Lexer lexer = init_lexer(input, file);
+  return parse_lexer(arena, &lexer);
+}
+
+// A point where the input may be cut: the start of a `struct` or `flags`
+// keyword outside of any braces or parentheses. The lexer state is recorded
+// so the part starting there reports the same locations as a serial parse.
+struct SplitPoint {
+  usize pos;
+  u32 line;
+  u32 column;
+};
+
+// Looks for split points in one pass that mirrors the lexer: identifiers
+// start on an alpha character outside of another identifier, and line/column
+// advance like in advance(). The parser only ever leaves a declaration
+// through a closing brace or by giving up on a token it does not consume, so
+// at depth zero a declaration keyword is always where a serial parse would
+// resume at the top level. Unbalanced input only means fewer split points.
+struct SplitScanner {
+  SplitPoint at;
+  usize brace_depth;
+  usize paren_depth;
+  bool in_identifier;
+};
+
+SplitScanner init_split_scanner() { return {{0, 1, 1}, 0, 0, false}; }
+
+// Longest keyword, plus the character after it.
+#define SPLIT_LOOKAHEAD 7
+
+// Advances through `input` and stops on the first split point at or after
+// `from`, without consuming it. Returns false once the scanner reaches the
+// end of `input`, or when `more` says the input continues and a keyword might
+// straddle its end; scanning resumes at the same place once more is there.
+static bool scan_to_split(SplitScanner *scanner, str8 input, usize from,
+                          bool more) {
+  for (; scanner->at.pos < input.len; scanner->at.pos++) {
+    usize pos = scanner->at.pos;
+    char c = char(input.data[pos]);
+    if (scanner->in_identifier) {
+      scanner->in_identifier = is_alnum(c);
+    } else if (is_alpha(c)) {
+      if (pos >= from && scanner->brace_depth == 0 &&
+          scanner->paren_depth == 0) {
+        if (more && input.len - pos < SPLIT_LOOKAHEAD)
+          return false;
+        str8 rest = str8_span(input, pos);
+        for (str8 keyword : {"struct"_u8, "flags"_u8}) {
+          if (rest.len >= keyword.len &&
+              str8_span(rest, 0, keyword.len).equal(keyword) &&
+              (rest.len == keyword.len ||
+               !is_alnum(char(rest.data[keyword.len]))))
+            return true;
+        }
+      }
+      scanner->in_identifier = true;
+    }
+
+    if (c == '{') {
+      scanner->brace_depth++;
+    } else if (c == '}') {
+      scanner->brace_depth -= scanner->brace_depth > 0;
+    } else if (c == '(') {
+      scanner->paren_depth++;
+    } else if (c == ')') {
+      scanner->paren_depth -= scanner->paren_depth > 0;
+    }
+
+    if (c == '\n') {
+      scanner->at.line++;
+      scanner->at.column = 1;
+    } else {
+      scanner->at.column++;
+    }
+  }
+  return false;
+}
+
+// Split points close to `count` evenly spaced targets, at most count - 1.
+static usize find_split_points(str8 input, SplitPoint *points, usize count) {
+  usize found = 0;
+  SplitScanner scanner = init_split_scanner();
+  while (found + 1 < count) {
+    usize target = input.len / count * (found + 1);
+    usize from = target > scanner.at.pos ? target : scanner.at.pos + 1;
+    if (!scan_to_split(&scanner, input, from, false))
+      break;
+    points[found++] = scanner.at;
+  }
+  return found;
+}
+
+template <class T> static T *arena_copy(Arena *arena, T *from, usize count) {
+  T *to = arena_push<T>(arena, count);
+  if (count) {
+    std::memcpy(to, from, count * sizeof(T));
+  }
+  return to;
+}
+
+// Upper bound on the arena bytes parse_file needs per byte of input. The
+// densest input is a field like `a b,`: 4 bytes that become a FieldDecl.
+#define PARSE_ARENA_FACTOR 16
+static_assert(sizeof(FieldDecl) <= 4 * PARSE_ARENA_FACTOR);
+
+ParseResult parse_file_parallel(Arena *arena, str8 input, u32 file,
+                                u32 thread_count) {
+  if (thread_count <= 1)
+    return parse_file(arena, input, file);
+
+  SplitPoint *points = arena_push<SplitPoint>(arena, thread_count + 1);
+  points[0] = {0, 1, 1};
+  usize chunk_count =
+      1 + find_split_points(input, points + 1, thread_count);
+  points[chunk_count] = {input.len, 0, 0};
+
+  // Each chunk lexes a prefix of the input starting at its split point, so
+  // token values and offsets stay relative to the whole file.
+  Arena **arenas = arena_push<Arena *>(arena, chunk_count);
+  ParseResult *results = arena_push<ParseResult>(arena, chunk_count);
+  std::thread *threads = arena_push<std::thread>(arena, chunk_count);
+  for (usize i = 0; i < chunk_count; i++) {
+    SplitPoint start = points[i];
+    usize end = points[i + 1].pos;
+    ArenaCreationInfo info{
+        .reserve_size = (end - start.pos) * PARSE_ARENA_FACTOR + MB(1)};
+    arenas[i] = arena_alloc(&info);
+    new (&threads[i]) std::thread([=] {
+      Lexer lexer = {{input.data, end}, start.pos, start.line, start.column,
+                     file};
+      results[i] = parse_lexer(arenas[i], &lexer);
+    });
+  }
+
+  // Declarations keep their place in the file: chunks are merged in order,
+  // and the arrays inside them are moved out of the chunk arenas.
+  ParseResult result{};
+  for (usize i = 0; i < chunk_count; i++) {
+    threads[i].join();
+    threads[i].~thread();
+
+    ParseResult *chunk = &results[i];
+    for (usize s = 0; s < chunk->struct_count; s++) {
+      StructDecl *decl = &chunk->structs[s];
+      decl->fields = arena_copy(arena, decl->fields, decl->field_count);
+      decl->generators =
+          arena_copy(arena, decl->generators, decl->generator_count);
+    }
+    for (usize f = 0; f < chunk->flags_count; f++) {
+      FlagsDecl *decl = &chunk->flags[f];
+      decl->members = arena_copy(arena, decl->members, decl->member_count);
+      decl->generators =
+          arena_copy(arena, decl->generators, decl->generator_count);
+    }
+    parse_result_append(&result, chunk);
+    arena_release(arenas[i]);
+  }
+  return result;
+}
+
+#define STREAM_CHUNK_SIZE MB(1)
+
+// The read buffer is reused once a declaration has been handed out, so its
+// strings are copied next to it. Offsets become relative to the file.
+static void stream_own_struct(Arena *arena, StructDecl *decl, usize base) {
+  decl->name = str8_copy(arena, decl->name);
+  decl->location.offset += base;
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    field->type_name = str8_copy(arena, field->type_name);
+    field->field_name = str8_copy(arena, field->field_name);
+    field->location.offset += base;
+  }
+  for (usize i = 0; i < decl->generator_count; i++) {
+    decl->generators[i] = str8_copy(arena, decl->generators[i]);
+  }
+}
+
+static void stream_own_flags(Arena *arena, FlagsDecl *decl, usize base) {
+  decl->name = str8_copy(arena, decl->name);
+  decl->location.offset += base;
+  for (usize i = 0; i < decl->member_count; i++) {
+    decl->members[i] = str8_copy(arena, decl->members[i]);
+  }
+  for (usize i = 0; i < decl->generator_count; i++) {
+    decl->generators[i] = str8_copy(arena, decl->generators[i]);
+  }
+}
+
+// Structs and flags are parsed into separate arrays; the sink gets them back
+// in source order.
+static void stream_emit(Arena *arena, ParseResult *result, usize base,
+                        DeclSink *sink, ErrorList *errors) {
+  usize s = 0;
+  usize f = 0;
+  while (s < result->struct_count || f < result->flags_count) {
+    if (f == result->flags_count ||
+        (s < result->struct_count && result->structs[s].location.offset <
+                                         result->flags[f].location.offset)) {
+      StructDecl *decl = &result->structs[s++];
+      stream_own_struct(arena, decl, base);
+      sink->on_struct(sink->user, arena, decl);
+    } else {
+      FlagsDecl *decl = &result->flags[f++];
+      stream_own_flags(arena, decl, base);
+      sink->on_flags(sink->user, arena, decl);
+    }
+  }
+  for (usize i = 0; i < result->errors.count; i++) {
+    ParseError *error = &result->errors.errors[i];
+    error->location.offset += base;
+    add_error(errors, error->message, error->location);
+  }
+}
+
+bool parse_stream(Arena *arena, const char *path, u32 file, DeclSink *sink,
+                  ErrorList *errors) {
+  FileStream *stream = os_stream_open(path);
+  if (!stream)
+    return false;
+  defer { os_stream_close(stream); };
+
+  // Holds what has been read but not parsed yet: the declaration being read
+  // plus the rest of the last chunk. It is alone in its arena so it can grow
+  // in place when a declaration does not fit.
+  ArenaCreationInfo info{.reserve_size = GB(64)};
+  Arena *buffer_arena = arena_alloc(&info);
+  defer { arena_release(buffer_arena); };
+  u8 *buffer = (u8 *)arena_push(buffer_arena, 0, 1);
+  usize capacity = 0;
+  usize len = 0;
+  // File offset of buffer[0].
+  usize base = 0;
+  bool more = true;
+
+  // Parts are cut at split points, like for the parallel parse, so each one
+  // normally holds a single declaration.
+  SplitScanner scanner = init_split_scanner();
+  SplitPoint start = scanner.at;
+  for (;;) {
+    bool split = scan_to_split(&scanner, {buffer, len}, start.pos + 1, more);
+    if (!split && more) {
+      // Move the unparsed part to the front, at most once per declaration,
+      // then append the next chunk.
+      if (start.pos > 0) {
+        len -= start.pos;
+        std::memmove(buffer, buffer + start.pos, len);
+        base += start.pos;
+        scanner.at.pos -= start.pos;
+        start.pos = 0;
+      }
+      if (capacity < len + STREAM_CHUNK_SIZE) {
+        arena_push(buffer_arena, len + STREAM_CHUNK_SIZE - capacity, 1);
+        capacity = len + STREAM_CHUNK_SIZE;
+      }
+      i64 n = os_stream_read(stream, buffer + len, STREAM_CHUNK_SIZE);
+      if (n < 0)
+        return false;
+      len += usize(n);
+      more = n > 0;
+      continue;
+    }
+
+    ScopedArena decl_arena = arena_scope_enter(arena);
+    Lexer lexer = {{buffer, scanner.at.pos}, start.pos, start.line,
+                   start.column, file};
+    ParseResult result = parse_lexer(decl_arena, &lexer);
+    stream_emit(decl_arena, &result, base, sink, errors);
+    parse_result_free(&result);
+    arena_scope_exit(decl_arena);
+
+    if (!split)
+      return true;
+    start = scanner.at;
+  }
+}
+
+// Arrays in a ParseResult don't record their capacity, so they are always
+// reallocated to the next power of two; appending stays amortized linear.
+template <class T> static void append_array(T **into, usize *count, T *from,
+                                            usize from_count) {
+  if (from_count == 0)
+    return;
+  usize capacity = 4;
+  while (capacity < *count + from_count) {
+    capacity *= 2;
+  }
+  *into = (T *)realloc(*into, capacity * sizeof(T));
+  std::memcpy(*into + *count, from, from_count * sizeof(T));
+  *count += from_count;
+}
+
+void parse_result_append(ParseResult *into, ParseResult *from) {
+  append_array(&into->structs, &into->struct_count, from->structs,
+               from->struct_count);
+  append_array(&into->flags, &into->flags_count, from->flags,
+               from->flags_count);
+  append_array(&into->errors.errors, &into->errors.count, from->errors.errors,
+               from->errors.count);
+  into->errors.capacity = into->errors.count;
+
+  free(from->structs);
+  free(from->flags);
+  free(from->errors.errors);
+  *from = {};
+}
+
+void parse_result_free(ParseResult *result) {
+  free(result->structs);
+  free(result->flags);
+  free(result->errors.errors);
+  *result = {};
+}
+
+void print_errors(ErrorList *errors, char **paths) {
   for (usize i = 0; i < errors->count; i++) {
-    printf("Error at line %d, column %d: %.*s\n",
-           errors->errors[i].location.line, errors->errors[i].location.column,
-           (int)errors->errors[i].message.len, errors->errors[i].message.data);
+    ParseError *error = &errors->errors[i];
+    fprintf(stderr, "%s:%u:%u: error: %.*s\n", paths[error->location.file],
+            error->location.line, error->location.column,
+            (int)error->message.len, error->message.data);
   }
 }
 
@@ -371,26 +729,587 @@ void print_parse_result(ParseResult *result) {
     }
     printf("  }\n");
   }
+  printf("Parsed %zu flags:\n", result->flags_count);
+  for (usize i = 0; i < result->flags_count; i++) {
+    FlagsDecl *f = &result->flags[i];
+    printf("  flags %.*s {\n", (int)f->name.len, f->name.data);
+    for (usize j = 0; j < f->member_count; j++) {
+      printf("    %.*s\n", (int)f->members[j].len, f->members[j].data);
+    }
+    printf("  }\n");
+  }
 }
 
-int main() {
-  auto test_input = "struct Player {\n"
-                    "    int health,\n"
-                    "    float speed,\n"
-                    "    char name\n"
-                    "}\n"
-                    "struct Enemy {\n"
-                    "    int damage\n"
-                    "} generates(to_string)\n"_u8;
+#define PARSE_CHUNK_MIN MB(4)
 
-  ParseResult result = parse_file(test_input);
+struct Options {
+  const char *output_dir;
+  str8 name;
+  bool split;
+  bool dump_ast;
+  bool watch;
+  bool stream;
+  u32 jobs;
+  char **inputs;
+  usize input_count;
+};
 
-  if (result.errors.count > 0) {
-    printf("Parse errors:\n");
-    print_errors(&result.errors);
-    // return 1;
+void print_usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options] <schema>...\n"
+          "  -o <dir>       write headers into <dir> instead of stdout\n"
+          "  --name <name>  name of the generated header (default: types)\n"
+          "  --split        one header per type, plus <name>_fwd.h and an\n"
+          "                 umbrella <name>.h (requires -o)\n"
+          "  --ast          print the parsed declarations\n"
+          "  --watch        treat inputs as directories and regenerate\n"
+          "                 whenever a *.data file in them changes\n"
+          "                 (requires -o)\n"
+          "  -j <n>         threads used to parse large inputs (default: one\n"
+          "                 per core)\n"
+          "  --stream       generate while reading, one declaration at a time,\n"
+          "                 for inputs larger than memory; types are checked\n"
+          "                 but must be declared before use\n",
+          program);
+}
+
+bool parse_options(int argc, char **argv, Options *options) {
+  // Inputs are compacted in place at the front of argv.
+  *options = {
+      .output_dir = nullptr,
+      .name = "types"_u8,
+      .split = false,
+      .dump_ast = false,
+      .watch = false,
+      .stream = false,
+      .jobs = std::thread::hardware_concurrency(),
+      .inputs = argv + 1,
+      .input_count = 0,
+  };
+
+  for (int i = 1; i < argc; i++) {
+    str8 arg = str8_from_cstr(argv[i]);
+    if (arg.equal("-o"_u8) && i + 1 < argc) {
+      options->output_dir = argv[++i];
+    } else if (arg.equal("--name"_u8) && i + 1 < argc) {
+      options->name = str8_from_cstr(argv[++i]);
+    } else if (arg.equal("--split"_u8)) {
+      options->split = true;
+    } else if (arg.equal("--ast"_u8)) {
+      options->dump_ast = true;
+    } else if (arg.equal("--watch"_u8)) {
+      options->watch = true;
+    } else if (arg.equal("--stream"_u8)) {
+      options->stream = true;
+    } else if (arg.equal("-j"_u8) && i + 1 < argc) {
+      options->jobs = u32(atoi(argv[++i]));
+    } else if (arg.len > 0 && arg.data[0] == '-') {
+      return false;
+    } else {
+      options->inputs[options->input_count++] = argv[i];
+    }
+  }
+
+  // Streamed output goes to stdout and the whole schema is never in memory.
+  if (options->stream && (options->output_dir || options->split ||
+                          options->watch || options->dump_ast))
+    return false;
+  return options->input_count > 0 &&
+         (!(options->split || options->watch) || options->output_dir);
+}
+
+// Leaves files untouched when their contents are already up to date, so
+// build systems only rebuild what actually changed. Existing outputs are read
+// and changed ones written in batches.
+bool write_outputs(Arena *arena, const char *dir, GeneratedFiles files) {
+  if (!os_make_directory(dir)) {
+    fprintf(stderr, "error: cannot create %s\n", dir);
+    return false;
+  }
+
+  ScopedArena scratch = arena_scope_enter(arena);
+  defer { arena_scope_exit(scratch); };
+
+  FileRead *existing = arena_push<FileRead>(scratch, files.count);
+  FileWrite *writes = arena_push<FileWrite>(scratch, files.count);
+  for (usize i = 0; i < files.count; i++) {
+    str8_builder path(scratch);
+    path.appendf("%s/%.*s", dir, (int)files.files[i].name.len,
+                 files.files[i].name.data);
+    existing[i] = {path.build_cstr(), scratch, {}, false};
+  }
+  os_read_files(existing, files.count);
+
+  usize write_count = 0;
+  for (usize i = 0; i < files.count; i++) {
+    if (!existing[i].ok || !existing[i].data.equal(files.files[i].contents)) {
+      writes[write_count++] = {existing[i].path, files.files[i].contents, false};
+    }
+  }
+  os_write_files(writes, write_count);
+
+  for (usize i = 0; i < write_count; i++) {
+    if (!writes[i].ok) {
+      fprintf(stderr, "error: cannot write %s\n", writes[i].path);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool is_schema_path(str8 path) {
+  str8 extension = ".data"_u8;
+  return path.len > extension.len &&
+         str8_span(path, path.len - extension.len).equal(extension);
+}
+
+// Each schema file owns an arena holding its contents, which its declarations
+// point into. It is reset with arena_pop_to whenever the file is re-read, and
+// only replaced when the new contents need more than it reserved.
+struct WatchedFile {
+  Arena *arena;
+  ParseResult parse;
+  bool changed;
+  bool removed;
+};
+
+struct WatchState {
+  // Lives as long as the process: file paths and the file table.
+  Arena *arena;
+  // Reset before every batch of events: the events themselves, the merged
+  // schema, the semantic pass and the generated headers.
+  Arena *cycle;
+  WatchedFile *files;
+  // Indexed like `files`, which is also the file index in SourceLocation.
+  char **paths;
+  usize file_count;
+  usize file_capacity;
+  // Set after a failed cycle: types that didn't resolve were never written,
+  // so the next cycle regenerates every header.
+  bool full;
+};
+
+usize watch_track(WatchState *state, str8 path) {
+  for (usize i = 0; i < state->file_count; i++) {
+    if (path.equal(str8_from_cstr(state->paths[i]))) {
+      return i;
+    }
+  }
+
+  if (state->file_count >= state->file_capacity) {
+    state->file_capacity = state->file_capacity ? state->file_capacity * 2 : 16;
+    state->files = (WatchedFile *)realloc(
+        state->files, state->file_capacity * sizeof(WatchedFile));
+    state->paths = (char **)realloc(state->paths,
+                                    state->file_capacity * sizeof(char *));
+  }
+
+  // The arena is sized for the file's contents once they are read.
+  usize index = state->file_count++;
+  state->files[index] = {nullptr, {}, true, false};
+  state->paths[index] = str8_to_cstr(state->arena, path);
+  return index;
+}
+
+// Re-reads every changed file in one batch and parses it again into its own
+// arena, which it keeps along with its declarations until it changes again.
+void watch_reparse(WatchState *state) {
+  ScopedArena scratch = arena_scope_enter(state->cycle);
+  defer { arena_scope_exit(scratch); };
+
+  FileRead *reads = arena_push<FileRead>(scratch, state->file_count);
+  usize *indices = arena_push<usize>(scratch, state->file_count);
+  usize count = 0;
+  for (usize i = 0; i < state->file_count; i++) {
+    WatchedFile *file = &state->files[i];
+    if (!file->changed)
+      continue;
+
+    parse_result_free(&file->parse);
+    if (file->removed && file->arena) {
+      arena_release(file->arena);
+      file->arena = nullptr;
+    }
+    if (!file->removed) {
+      reads[count] = {state->paths[i], scratch, {}, false};
+      indices[count++] = i;
+    }
+  }
+
+  os_read_files(reads, count);
+  for (usize r = 0; r < count; r++) {
+    WatchedFile *file = &state->files[indices[r]];
+    if (!reads[r].ok) {
+      if (file->arena) {
+        arena_release(file->arena);
+        file->arena = nullptr;
+      }
+      file->removed = true;
+      continue;
+    }
+    usize len = reads[r].data.len;
+    usize needed = len + len * PARSE_ARENA_FACTOR + MB(1);
+    if (file->arena && needed <= file->arena->reserved - file->arena->base) {
+      arena_pop_to(file->arena, file->arena->base);
+    } else {
+      if (file->arena) {
+        arena_release(file->arena);
+      }
+      ArenaCreationInfo info{.reserve_size = needed + sizeof(Arena)};
+      file->arena = arena_alloc(&info);
+    }
+    str8 input = str8_copy(file->arena, reads[r].data);
+    file->parse = parse_file(file->arena, input, u32(indices[r]));
+  }
+}
+
+// Regenerates the headers of the types declared in changed files and of
+// everything that depends on them; write_outputs then skips any output
+// whose contents came out the same.
+bool watch_regenerate(WatchState *state, Options *options) {
+  Arena *cycle = state->cycle;
+
+  usize struct_count = 0;
+  usize flags_count = 0;
+  for (usize i = 0; i < state->file_count; i++) {
+    struct_count += state->files[i].parse.struct_count;
+    flags_count += state->files[i].parse.flags_count;
+  }
+
+  ParseResult merged{};
+  merged.structs = arena_push<StructDecl>(cycle, struct_count);
+  merged.flags = arena_push<FlagsDecl>(cycle, flags_count);
+  bool *dirty = arena_push<bool>(cycle, struct_count + flags_count);
+  for (usize i = 0; i < state->file_count; i++) {
+    WatchedFile *file = &state->files[i];
+    bool changed = file->changed || state->full;
+    file->changed = false;
+
+    for (usize j = 0; j < file->parse.struct_count; j++) {
+      dirty[merged.struct_count] = changed;
+      merged.structs[merged.struct_count++] = file->parse.structs[j];
+    }
+    for (usize j = 0; j < file->parse.flags_count; j++) {
+      dirty[struct_count + merged.flags_count] = changed;
+      merged.flags[merged.flags_count++] = file->parse.flags[j];
+    }
+    for (usize j = 0; j < file->parse.errors.count; j++) {
+      add_error(&merged.errors, file->parse.errors.errors[j].message,
+                file->parse.errors.errors[j].location);
+    }
+  }
+  defer { free(merged.errors.errors); };
+
+  SemaResult sema = analyze(cycle, &merged, state->paths);
+  if (merged.errors.count > 0) {
+    print_errors(&merged.errors, state->paths);
+    state->full = true;
+    return false;
+  }
+
+  // Dependencies come first in `order`, so one pass reaches every type that
+  // holds a changed type by value, however indirectly.
+  for (usize i = 0; i < sema.order_count; i++) {
+    TypeRef type = sema.order[i];
+    if (type.kind != TYPE_STRUCT)
+      continue;
+    StructDecl *decl = &merged.structs[type.index];
+    for (usize f = 0; f < decl->field_count; f++) {
+      TypeRef dep = decl->fields[f].type;
+      if ((dep.kind == TYPE_STRUCT || dep.kind == TYPE_FLAGS) &&
+          dirty[type_slot(&merged, dep)]) {
+        dirty[type.index] = true;
+      }
+    }
   }
 
-  print_parse_result(&result);
+  ErrorList gen_errors{};
+  defer { free(gen_errors.errors); };
+  GeneratedFiles files =
+      options->split ? gen_split_headers(cycle, &merged, &sema, options->name,
+                                         dirty, &gen_errors)
+                     : gen_single_header(cycle, &merged, &sema, options->name,
+                                         &gen_errors);
+  if (gen_errors.count > 0) {
+    print_errors(&gen_errors, state->paths);
+    state->full = true;
+    return false;
+  }
+  if (!write_outputs(cycle, options->output_dir, files)) {
+    state->full = true;
+    return false;
+  }
+
+  state->full = false;
+  fprintf(stderr, "datagen: regenerated %zu header(s)\n", files.count);
+  return true;
+}
+
+// Tracks every schema file in `dir` and marks it changed. Returns false if the
+// directory cannot be listed.
+bool watch_list(WatchState *state, const char *dir) {
+  str8_list *entries = os_list_directory(state->cycle, dir);
+  if (!entries)
+    return false;
+  for (str8_list *entry = entries; entry; entry = entry->next) {
+    if (is_schema_path(entry->data)) {
+      // watch_track can move the table, so it runs before indexing.
+      usize index = watch_track(state, entry->data);
+      WatchedFile *file = &state->files[index];
+      file->changed = true;
+      file->removed = false;
+    }
+  }
+  return true;
+}
+
+int run_watch(Options *options) {
+  FileWatch *watch = os_watch_create();
+  if (!watch) {
+    fprintf(stderr, "error: cannot initialize file watching\n");
+    return 1;
+  }
+
+  ArenaCreationInfo info{};
+  // Holds the merged schema and generated output of a cycle, and the files
+  // being reread; only address space is reserved up front.
+  ArenaCreationInfo cycle_info{.reserve_size = GB(64)};
+  WatchState state{};
+  state.arena = arena_alloc(&info);
+  state.cycle = arena_alloc(&cycle_info);
+  state.full = true;
+
+  // Watch before listing so no edit falls in between.
+  for (usize i = 0; i < options->input_count; i++) {
+    const char *dir = options->inputs[i];
+    if (!os_watch_add(watch, dir) || !watch_list(&state, dir)) {
+      fprintf(stderr, "error: cannot watch %s\n", dir);
+      return 1;
+    }
+  }
+
+  for (;;) {
+    watch_reparse(&state);
+    watch_regenerate(&state, options);
+
+    arena_clear(state.cycle);
+    WatchEvent *events = os_watch_wait(watch, state.cycle, 50);
+    if (!events) {
+      fprintf(stderr, "error: file watching failed\n");
+      return 1;
+    }
+    for (WatchEvent *event = events; event; event = event->next) {
+      if (event->overflow) {
+        // Any file may have changed, appeared or gone: reread all of them,
+        // and whatever is no longer listed counts as removed.
+        fprintf(stderr, "datagen: missed file events, rescanning inputs\n");
+        for (usize i = 0; i < state.file_count; i++) {
+          state.files[i].changed = true;
+          state.files[i].removed = true;
+        }
+        for (usize i = 0; i < options->input_count; i++) {
+          if (!watch_list(&state, options->inputs[i])) {
+            fprintf(stderr, "error: cannot list %s\n", options->inputs[i]);
+            return 1;
+          }
+        }
+        continue;
+      }
+      if (!is_schema_path(event->path))
+        continue;
+      usize index = watch_track(&state, event->path);
+      WatchedFile *file = &state.files[index];
+      file->changed = true;
+      file->removed = event->removed;
+    }
+  }
+}
+
+// Streaming never sees the whole schema, so there is no full semantic pass:
+// every type must be declared before a field uses it, which also means
+// by-value cycles cannot occur. Only the names of the types seen so far are
+// kept, with the generators of each struct for the nested checks.
+struct StreamState {
+  // Outlives the declarations: type names and error messages.
+  Arena *arena;
+  TypeIndex types;
+  // gen_generator_mask of every struct, by TypeRef::index. Alone in its arena
+  // so it stays contiguous as it grows.
+  Arena *generators_arena;
+  u32 *generators;
+  u32 struct_count;
+  u32 flags_count;
+  ErrorList errors;
+};
+
+static void stream_declare(StreamState *state, str8 name, TypeRef type,
+                           SourceLocation location) {
+  // The index keeps the name, so it must outlive the declaration.
+  str8 owned = str8_copy(state->arena, name);
+  TypeIndexSlot *slot = type_index_add(&state->types, owned, type);
+  if (!slot)
+    return;
+  if (slot->type.kind == TYPE_BUILTIN) {
+    sema_error(state->arena, &state->errors, location,
+               "Type '%.*s' redefines a builtin type", GEN_STR8(name));
+  } else {
+    sema_error(state->arena, &state->errors, location,
+               "Duplicate type '%.*s' (already declared earlier in the input)",
+               GEN_STR8(name));
+  }
+}
+
+static void stream_write(str8_builder *out) {
+  str8 code = out->build();
+  fwrite(code.data, 1, code.len, stdout);
+}
+
+static void stream_struct(void *user, Arena *arena, StructDecl *decl) {
+  StreamState *state = (StreamState *)user;
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    field->type = type_index_find(&state->types, field->type_name)->type;
+    if (field->type.kind == TYPE_UNRESOLVED) {
+      sema_error(state->arena, &state->errors, field->location,
+                 "Unknown type '%.*s' for field '%.*s' (with --stream, types "
+                 "must be declared before use)",
+                 GEN_STR8(field->type_name), GEN_STR8(field->field_name));
+    } else if (field->type.kind == TYPE_STRUCT) {
+      gen_check_field(state->arena, decl, field,
+                      state->generators[field->type.index], &state->errors);
+    }
+  }
+  gen_check_struct(state->arena, decl, &state->errors);
+  *arena_push<u32>(state->generators_arena) = gen_generator_mask(decl);
+  stream_declare(state, decl->name, {TYPE_STRUCT, state->struct_count++},
+                 decl->location);
+
+  str8_builder out(arena);
+  gen_struct_decl(&out, decl, &state->errors);
+  stream_write(&out);
+}
+
+static void stream_flags(void *user, Arena *arena, FlagsDecl *decl) {
+  StreamState *state = (StreamState *)user;
+  if (decl->member_count > FLAGS_MAX_MEMBERS) {
+    sema_error(state->arena, &state->errors, decl->location,
+               "Flags '%.*s' has %zu members, at most %d are supported",
+               GEN_STR8(decl->name), decl->member_count, FLAGS_MAX_MEMBERS);
+  }
+  stream_declare(state, decl->name, {TYPE_FLAGS, state->flags_count++},
+                 decl->location);
+
+  str8_builder out(arena);
+  gen_flags_decl(&out, decl, &state->errors);
+  stream_write(&out);
+}
+
+int run_stream(Options *options) {
+  // Only ever holds one declaration, but that one can be arbitrarily large.
+  ArenaCreationInfo arena_info{.reserve_size = GB(64)};
+  Arena *arena = arena_alloc(&arena_info);
+  defer { arena_release(arena); };
+  // These grow with the number of types and errors in the whole input.
+  ArenaCreationInfo state_info{.reserve_size = GB(64)};
+  StreamState state = {};
+  state.arena = arena_alloc(&state_info);
+  defer { arena_release(state.arena); };
+  state.generators_arena = arena_alloc(&state_info);
+  defer { arena_release(state.generators_arena); };
+  state.generators = arena_push<u32>(state.generators_arena, 0);
+  state.types = type_index_make(0);
+  defer { type_index_release(&state.types); };
+  type_index_add_builtins(&state.types);
+
+  {
+    ScopedArena scratch = arena_scope_enter(arena);
+    str8_builder out(scratch);
+    gen_preamble_all(&out);
+    stream_write(&out);
+    arena_scope_exit(scratch);
+  }
+
+  DeclSink sink = {&state, stream_struct, stream_flags};
+  for (usize i = 0; i < options->input_count; i++) {
+    if (!parse_stream(arena, options->inputs[i], u32(i), &sink,
+                      &state.errors)) {
+      fprintf(stderr, "error: cannot read %s\n", options->inputs[i]);
+      return 1;
+    }
+  }
+
+  if (state.errors.count > 0) {
+    print_errors(&state.errors, options->inputs);
+    return 1;
+  }
   return 0;
 }
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parse_options(argc, argv, &options)) {
+    print_usage(argv[0]);
+    return 2;
+  }
+  if (options.watch) {
+    return run_watch(&options);
+  }
+  if (options.stream) {
+    return run_stream(&options);
+  }
+
+  // Inputs are read whole, so reserve enough for very large schemas.
+  ArenaCreationInfo arena_info{.reserve_size = GB(64)};
+  Arena *arena = arena_alloc(&arena_info);
+  defer { arena_release(arena); };
+
+  FileRead *inputs = arena_push<FileRead>(arena, options.input_count);
+  for (usize i = 0; i < options.input_count; i++) {
+    inputs[i] = {options.inputs[i], arena, {}, false};
+  }
+  os_read_files(inputs, options.input_count);
+
+  ParseResult result{};
+  for (usize i = 0; i < options.input_count; i++) {
+    if (!inputs[i].ok) {
+      fprintf(stderr, "error: cannot read %s\n", options.inputs[i]);
+      return 1;
+    }
+    // Small chunks are not worth a thread.
+    usize chunks = inputs[i].data.len / PARSE_CHUNK_MIN;
+    u32 threads = chunks < options.jobs ? u32(chunks) : options.jobs;
+    ParseResult file =
+        parse_file_parallel(arena, inputs[i].data, u32(i), threads);
+    parse_result_append(&result, &file);
+  }
+  SemaResult sema = analyze(arena, &result, options.inputs);
+
+  if (options.dump_ast) {
+    print_parse_result(&result);
+  }
+  if (result.errors.count > 0) {
+    print_errors(&result.errors, options.inputs);
+    return 1;
+  }
+
+  ErrorList gen_errors{};
+  GeneratedFiles files =
+      options.split
+          ? gen_split_headers(arena, &result, &sema, options.name, nullptr,
+                              &gen_errors)
+          : gen_single_header(arena, &result, &sema, options.name,
+                              &gen_errors);
+  if (gen_errors.count > 0) {
+    print_errors(&gen_errors, options.inputs);
+    return 1;
+  }
+
+  if (!options.output_dir) {
+    for (usize i = 0; i < files.count; i++) {
+      printf("%.*s", (int)files.files[i].contents.len,
+             files.files[i].contents.data);
+    }
+    return 0;
+  }
+  return write_outputs(arena, options.output_dir, files) ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+#include "gen/gen.h"
+
+static GeneratorInfo generators[] = {
+    {"soa"_u8, gen_soa, {}, false, gen_soa_check},
+    {"serialize"_u8, gen_serialize, "runtime/serialize.h"_u8, true, nullptr},
+    {"hash"_u8, gen_hash, "runtime/hash.h"_u8, true, nullptr},
+};
+
+#define GENERATOR_COUNT (sizeof(generators) / sizeof(generators[0]))
+static_assert(GENERATOR_COUNT <= 32, "generator masks are u32");
+
+GeneratorInfo *find_generator(str8 name) {
+  for (auto &generator : generators) {
+    if (generator.name.equal(name)) {
+      return &generator;
+    }
+  }
+  return nullptr;
+}
+
+BuiltinType *gen_scalar_type(FieldDecl *field) {
+  switch (field->type.kind) {
+  case TYPE_BUILTIN:
+    return builtin_type(field->type.index);
+  case TYPE_FLAGS:
+    return find_builtin_type(str8_lit(FLAGS_STORAGE_TYPE));
+  case TYPE_STRUCT:
+    return nullptr;
+  case TYPE_UNRESOLVED:
+    break;
+  }
+  // Not analyzed: only builtins can be recognized by name.
+  return find_builtin_type(field->type_name);
+}
+
+usize gen_packed_size(StructDecl *decl) {
+  usize size = 0;
+  u32 align = 1;
+  for (usize i = 0; i < decl->field_count; i++) {
+    // Builtins are aligned to their size.
+    BuiltinType *type = gen_scalar_type(&decl->fields[i]);
+    if (!type || size % type->size != 0)
+      return 0;
+    size += type->size;
+    align = type->size > align ? type->size : align;
+  }
+  return size % align == 0 ? size : 0;
+}
+
+u32 gen_generator_mask(StructDecl *decl) {
+  u32 mask = 0;
+  for (usize i = 0; i < decl->generator_count; i++) {
+    if (GeneratorInfo *generator = find_generator(decl->generators[i])) {
+      mask |= 1u << (generator - generators);
+    }
+  }
+  return mask;
+}
+
+void gen_check_field(Arena *arena, StructDecl *decl, FieldDecl *field,
+                     u32 field_mask, ErrorList *errors) {
+  u32 missing = gen_generator_mask(decl) & ~field_mask;
+  for (usize i = 0; i < GENERATOR_COUNT; i++) {
+    if (!generators[i].nested || !(missing & (1u << i)))
+      continue;
+    str8_builder message(arena);
+    message.appendf("Field '%.*s' needs type '%.*s' to generate '%.*s' too",
+                    GEN_STR8(field->field_name), GEN_STR8(field->type_name),
+                    GEN_STR8(generators[i].name));
+    add_error(errors, message.build(), field->location);
+  }
+}
+
+void gen_check_struct(Arena *arena, StructDecl *decl, ErrorList *errors) {
+  for (usize i = 0; i < decl->generator_count; i++) {
+    GeneratorInfo *generator = find_generator(decl->generators[i]);
+    if (generator && generator->check) {
+      generator->check(arena, decl, errors);
+    }
+  }
+}
+
+void gen_check_fields(Arena *arena, ParseResult *parse, ErrorList *errors) {
+  for (usize s = 0; s < parse->struct_count; s++) {
+    StructDecl *decl = &parse->structs[s];
+    gen_check_struct(arena, decl, errors);
+    for (usize f = 0; f < decl->field_count; f++) {
+      FieldDecl *field = &decl->fields[f];
+      if (field->type.kind == TYPE_STRUCT) {
+        gen_check_field(arena, decl, field,
+                        gen_generator_mask(&parse->structs[field->type.index]),
+                        errors);
+      }
+    }
+  }
+}
+
+void gen_preamble(str8_builder *out, StructDecl *decls, usize count) {
+  out->append("#pragma once\n\n#include \"core/core.h\"\n");
+  for (auto &generator : generators) {
+    if (generator.include.len == 0)
+      continue;
+
+    bool used = false;
+    for (usize i = 0; i < count && !used; i++) {
+      for (usize j = 0; j < decls[i].generator_count && !used; j++) {
+        used = decls[i].generators[j].equal(generator.name);
+      }
+    }
+    if (used) {
+      out->appendf("#include \"%.*s\"\n", GEN_STR8(generator.include));
+    }
+  }
+  out->append("\n");
+}
+
+void gen_preamble_all(str8_builder *out) {
+  out->append("#pragma once\n\n#include \"core/core.h\"\n");
+  for (auto &generator : generators) {
+    if (generator.include.len > 0) {
+      out->appendf("#include \"%.*s\"\n", GEN_STR8(generator.include));
+    }
+  }
+  out->append("\n");
+}
+
+void gen_struct(str8_builder *out, StructDecl *decl) {
+  out->appendf("struct %.*s {\n", GEN_STR8(decl->name));
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    out->appendf("  %.*s %.*s;\n", GEN_STR8(field->type_name),
+                 GEN_STR8(field->field_name));
+  }
+  out->append("};\n\n");
+}
+
+void gen_flags(str8_builder *out, FlagsDecl *decl) {
+  out->appendf("enum class %.*s : " FLAGS_STORAGE_TYPE " {\n",
+               GEN_STR8(decl->name));
+  for (usize i = 0; i < decl->member_count; i++) {
+    out->appendf("  %.*s = 1u << %zu,\n", GEN_STR8(decl->members[i]), i);
+  }
+  out->append("};\n\n");
+
+  const char *ops[] = {"|", "&", "^"};
+  for (const char *op : ops) {
+    out->appendf("inline %.*s operator%s(%.*s a, %.*s b) {\n"
+                 "  return %.*s(" FLAGS_STORAGE_TYPE "(a) %s "
+                 FLAGS_STORAGE_TYPE "(b));\n"
+                 "}\n",
+                 GEN_STR8(decl->name), op, GEN_STR8(decl->name),
+                 GEN_STR8(decl->name), GEN_STR8(decl->name), op);
+  }
+  out->appendf("inline %.*s operator~(%.*s a) {\n"
+               "  return %.*s(~" FLAGS_STORAGE_TYPE "(a));\n"
+               "}\n\n",
+               GEN_STR8(decl->name), GEN_STR8(decl->name),
+               GEN_STR8(decl->name));
+}
+
+void gen_struct_decl(str8_builder *out, StructDecl *decl, ErrorList *errors) {
+  gen_struct(out, decl);
+  for (usize i = 0; i < decl->generator_count; i++) {
+    GeneratorInfo *generator = find_generator(decl->generators[i]);
+    if (!generator) {
+      add_error(errors, "Unknown generator"_u8, decl->location);
+      continue;
+    }
+    generator->generate(out, decl);
+  }
+}
+
+void gen_flags_decl(str8_builder *out, FlagsDecl *decl, ErrorList *errors) {
+  gen_flags(out, decl);
+  // No generator applies to flags yet.
+  for (usize i = 0; i < decl->generator_count; i++) {
+    add_error(errors, "Unknown generator"_u8, decl->location);
+  }
+}
@@ -0,0 +1,99 @@
+#ifndef GEN_GEN_H
+#define GEN_GEN_H
+
+#include "ast.h"
+#include "core/core.h"
+#include "sema.h"
+
+// Expands to the printf arguments matching a "%.*s" conversion.
+#define GEN_STR8(s) (int)(s).len, (s).data
+
+using StructGenerator = void (*)(str8_builder *out, StructDecl *decl);
+// Reports what the generator cannot emit for `decl`.
+using StructCheck = void (*)(Arena *arena, StructDecl *decl,
+                             ErrorList *errors);
+
+struct GeneratorInfo {
+  str8 name;
+  StructGenerator generate;
+  // Runtime header the generated code depends on, empty if none.
+  str8 include;
+  // The output for a struct calls the same generator's output for its
+  // struct fields, so their types must list this generator too.
+  bool nested;
+  // nullptr if the generator handles every struct.
+  StructCheck check;
+};
+
+// Returns the generator registered under the name used in `generates(...)`,
+// or nullptr if there is none.
+GeneratorInfo *find_generator(str8 name);
+
+// Builtin type a field is stored as: builtins themselves and flags as their
+// underlying integer. nullptr for nested structs.
+BuiltinType *gen_scalar_type(FieldDecl *field);
+
+// sizeof the struct if its fields are scalars laid out back to back with no
+// padding in between or at the end, 0 otherwise.
+usize gen_packed_size(StructDecl *decl);
+
+// Bit i is set if `decl` lists the i-th registered generator.
+u32 gen_generator_mask(StructDecl *decl);
+// Reports an error if `decl` lists a `nested` generator that the struct type
+// of `field`, whose generator mask is `field_mask`, does not.
+void gen_check_field(Arena *arena, StructDecl *decl, FieldDecl *field,
+                     u32 field_mask, ErrorList *errors);
+// Runs the checks of the generators `decl` lists.
+void gen_check_struct(Arena *arena, StructDecl *decl, ErrorList *errors);
+// gen_check_struct for every struct of an analyzed schema, and
+// gen_check_field for every struct field.
+void gen_check_fields(Arena *arena, ParseResult *parse, ErrorList *errors);
+
+void gen_struct(str8_builder *out, StructDecl *decl);
+void gen_soa(str8_builder *out, StructDecl *decl);
+void gen_soa_check(Arena *arena, StructDecl *decl, ErrorList *errors);
+void gen_serialize(str8_builder *out, StructDecl *decl);
+void gen_hash(str8_builder *out, StructDecl *decl);
+void gen_flags(str8_builder *out, FlagsDecl *decl);
+
+// Emits the includes needed by the generators used in `decls`.
+void gen_preamble(str8_builder *out, StructDecl *decls, usize count);
+// Emits the includes of every generator, for output written before all
+// declarations are known.
+void gen_preamble_all(str8_builder *out);
+
+// Emits the definition of `decl` followed by the output of every generator
+// listed in its `generates(...)` clause.
+void gen_struct_decl(str8_builder *out, StructDecl *decl, ErrorList *errors);
+void gen_flags_decl(str8_builder *out, FlagsDecl *decl, ErrorList *errors);
+
+struct GeneratedFile {
+  // Relative to the output directory.
+  str8 name;
+  str8 contents;
+};
+
+struct GeneratedFiles {
+  GeneratedFile *files;
+  usize count;
+};
+
+// Every declaration in dependency order in a single `<name>.h`.
+GeneratedFiles gen_single_header(Arena *arena, ParseResult *parse,
+                                 SemaResult *sema, str8 name,
+                                 ErrorList *errors);
+
+// Index of a struct or flags declaration in arrays covering both: structs
+// first, then flags.
+usize type_slot(ParseResult *parse, TypeRef type);
+
+// One `<Type>.h` per declaration that includes only the headers of the types
+// it holds by value, a `<name>_fwd.h` with forward declarations of every
+// type, and an umbrella `<name>.h` including all per-type headers.
+// If `dirty` is not null, per-type headers are only produced for the types
+// whose type_slot is set.
+GeneratedFiles gen_split_headers(Arena *arena, ParseResult *parse,
+                                 SemaResult *sema, str8 name, bool *dirty,
+                                 ErrorList *errors);
+
+#endif
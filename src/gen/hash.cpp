@@ -0,0 +1,151 @@
+#include "gen/gen.h"
+
+struct FieldRun {
+  usize count;
+  u32 size;
+};
+
+// Longest sequence of adjacent non-floating builtin fields starting at
+// `first` that sit back to back in memory. No later field may be more aligned
+// than the first one, otherwise the compiler may insert padding in between.
+static FieldRun field_run(StructDecl *decl, usize first) {
+  BuiltinType *type = gen_scalar_type(&decl->fields[first]);
+  if (!type || type->floating)
+    return {0, 0};
+
+  FieldRun run = {1, type->size};
+  for (usize i = first + 1; i < decl->field_count; i++) {
+    BuiltinType *next = gen_scalar_type(&decl->fields[i]);
+    if (!next || next->floating || next->size > type->size ||
+        run.size % next->size != 0)
+      break;
+    run.count++;
+    run.size += next->size;
+  }
+  return run;
+}
+
+// A struct that is one padding-free run can be compared and hashed as a whole.
+static bool is_trivially_comparable(StructDecl *decl) {
+  if (decl->field_count == 0)
+    return false;
+  FieldRun run = field_run(decl, 0);
+  if (run.count != decl->field_count)
+    return false;
+  u32 align = gen_scalar_type(&decl->fields[0])->size;
+  return run.size % align == 0;
+}
+
+static void gen_run_check(str8_builder *out, StructDecl *decl, usize first,
+                          FieldRun run) {
+  FieldDecl *head = &decl->fields[first];
+  FieldDecl *last = &decl->fields[first + run.count - 1];
+  out->appendf("static_assert(offsetof(%.*s, %.*s) + sizeof(%.*s::%.*s) - "
+               "offsetof(%.*s, %.*s) == %u);\n",
+               GEN_STR8(decl->name), GEN_STR8(last->field_name),
+               GEN_STR8(decl->name), GEN_STR8(last->field_name),
+               GEN_STR8(decl->name), GEN_STR8(head->field_name), run.size);
+}
+
+static void gen_hash_trivial(str8_builder *out, StructDecl *decl) {
+  out->appendf(
+      "static_assert(std::has_unique_object_representations_v<%.*s>);\n\n"
+      "inline bool operator==(const %.*s &a, const %.*s &b) {\n"
+      "  return std::memcmp(&a, &b, sizeof(%.*s)) == 0;\n"
+      "}\n\n"
+      "inline u64 hash(const %.*s &value, u64 seed = 0) {\n"
+      "  return hash_finish(hash_bytes(seed, &value, sizeof(%.*s)));\n"
+      "}\n\n",
+      GEN_STR8(decl->name), GEN_STR8(decl->name), GEN_STR8(decl->name),
+      GEN_STR8(decl->name), GEN_STR8(decl->name), GEN_STR8(decl->name));
+}
+
+static void gen_hash_fields(str8_builder *out, StructDecl *decl) {
+  bool checked = false;
+  for (usize i = 0; i < decl->field_count;) {
+    FieldRun run = field_run(decl, i);
+    if (run.count > 1) {
+      gen_run_check(out, decl, i, run);
+      checked = true;
+    }
+    i += run.count ? run.count : 1;
+  }
+  if (checked) {
+    out->append("\n");
+  }
+
+  // Cheapest comparisons first so a mismatch exits early: raw runs, then
+  // floats, then nested structs which may recurse arbitrarily deep.
+  out->appendf("inline bool operator==(const %.*s &a, const %.*s &b) {\n"
+               "  return ",
+               GEN_STR8(decl->name), GEN_STR8(decl->name));
+  const char *sep = "";
+  for (usize i = 0; i < decl->field_count;) {
+    FieldRun run = field_run(decl, i);
+    str8 name = decl->fields[i].field_name;
+    if (run.count > 1) {
+      out->appendf("%sstd::memcmp(&a.%.*s, &b.%.*s, %u) == 0", sep,
+                   GEN_STR8(name), GEN_STR8(name), run.size);
+      sep = " &&\n         ";
+    } else if (run.count == 1) {
+      out->appendf("%sa.%.*s == b.%.*s", sep, GEN_STR8(name),
+                   GEN_STR8(name));
+      sep = " &&\n         ";
+    }
+    i += run.count ? run.count : 1;
+  }
+  for (usize i = 0; i < decl->field_count; i++) {
+    BuiltinType *type = gen_scalar_type(&decl->fields[i]);
+    str8 name = decl->fields[i].field_name;
+    if (type && type->floating) {
+      out->appendf("%sa.%.*s == b.%.*s", sep, GEN_STR8(name),
+                   GEN_STR8(name));
+      sep = " &&\n         ";
+    }
+  }
+  for (usize i = 0; i < decl->field_count; i++) {
+    str8 name = decl->fields[i].field_name;
+    if (!gen_scalar_type(&decl->fields[i])) {
+      out->appendf("%sa.%.*s == b.%.*s", sep, GEN_STR8(name),
+                   GEN_STR8(name));
+      sep = " &&\n         ";
+    }
+  }
+  out->appendf("%s;\n}\n\n", *sep ? "" : "true");
+
+  out->appendf("inline u64 hash(const %.*s &value, u64 seed = 0) {\n"
+               "  u64 h = seed;\n",
+               GEN_STR8(decl->name));
+  for (usize i = 0; i < decl->field_count;) {
+    FieldRun run = field_run(decl, i);
+    FieldDecl *field = &decl->fields[i];
+    BuiltinType *type = gen_scalar_type(field);
+    if (run.count) {
+      out->appendf("  h = hash_bytes(h, &value.%.*s, %u);\n",
+                   GEN_STR8(field->field_name), run.size);
+    } else if (type) {
+      out->appendf("  h = hash_float(h, f64(value.%.*s));\n",
+                   GEN_STR8(field->field_name));
+    } else {
+      out->appendf("  h = hash_mix(h, hash(value.%.*s));\n",
+                   GEN_STR8(field->field_name));
+    }
+    i += run.count ? run.count : 1;
+  }
+  out->append("  return hash_finish(h);\n}\n\n");
+}
+
+void gen_hash(str8_builder *out, StructDecl *decl) {
+  if (is_trivially_comparable(decl)) {
+    gen_hash_trivial(out, decl);
+  } else {
+    gen_hash_fields(out, decl);
+  }
+
+  out->appendf("template <> struct std::hash<%.*s> {\n"
+               "  usize operator()(const %.*s &value) const noexcept {\n"
+               "    return ::hash(value);\n"
+               "  }\n"
+               "};\n\n",
+               GEN_STR8(decl->name), GEN_STR8(decl->name));
+}
@@ -0,0 +1,148 @@
+#include "gen/gen.h"
+
+static str8 type_name(ParseResult *parse, TypeRef type) {
+  return type.kind == TYPE_STRUCT ? parse->structs[type.index].name
+                                  : parse->flags[type.index].name;
+}
+
+usize type_slot(ParseResult *parse, TypeRef type) {
+  return type.kind == TYPE_STRUCT ? type.index
+                                  : parse->struct_count + type.index;
+}
+
+static str8 header_name(Arena *arena, str8 name, const char *suffix) {
+  str8_builder b(arena);
+  b.appendf("%.*s%s.h", GEN_STR8(name), suffix);
+  return b.build();
+}
+
+static void gen_decl(str8_builder *out, ParseResult *parse, TypeRef type,
+                     ErrorList *errors) {
+  if (type.kind == TYPE_STRUCT) {
+    gen_struct_decl(out, &parse->structs[type.index], errors);
+  } else {
+    gen_flags_decl(out, &parse->flags[type.index], errors);
+  }
+}
+
+// Per-type headers share the output directory with `<name>.h` and
+// `<name>_fwd.h`; a type with one of those names would overwrite it.
+static void check_header_name(Arena *arena, str8 type, SourceLocation location,
+                              str8 name, ErrorList *errors) {
+  str8 fwd_suffix = "_fwd"_u8;
+  bool is_fwd = type.len == name.len + fwd_suffix.len &&
+                str8_span(type, 0, name.len).equal(name) &&
+                str8_span(type, name.len).equal(fwd_suffix);
+  if (!type.equal(name) && !is_fwd)
+    return;
+  str8_builder message(arena);
+  message.appendf("Type '%.*s' has the same header name as the generated "
+                  "'%.*s.h'; rename it or change --name",
+                  GEN_STR8(type), GEN_STR8(type));
+  add_error(errors, message.build(), location);
+}
+
+GeneratedFiles gen_single_header(Arena *arena, ParseResult *parse,
+                                 SemaResult *sema, str8 name,
+                                 ErrorList *errors) {
+  gen_check_fields(arena, parse, errors);
+  GeneratedFile *file = arena_push<GeneratedFile>(arena);
+  file->name = header_name(arena, name, "");
+
+  str8_builder out(arena);
+  gen_preamble(&out, parse->structs, parse->struct_count);
+  for (usize i = 0; i < sema->order_count; i++) {
+    gen_decl(&out, parse, sema->order[i], errors);
+  }
+  file->contents = out.build();
+
+  return {file, 1};
+}
+
+GeneratedFiles gen_split_headers(Arena *arena, ParseResult *parse,
+                                 SemaResult *sema, str8 name, bool *dirty,
+                                 ErrorList *errors) {
+  gen_check_fields(arena, parse, errors);
+  for (usize i = 0; i < parse->struct_count; i++) {
+    check_header_name(arena, parse->structs[i].name,
+                      parse->structs[i].location, name, errors);
+  }
+  for (usize i = 0; i < parse->flags_count; i++) {
+    check_header_name(arena, parse->flags[i].name, parse->flags[i].location,
+                      name, errors);
+  }
+
+  GeneratedFile *files =
+      arena_push<GeneratedFile>(arena, sema->order_count + 2);
+  usize count = 0;
+  // included[t] == i + 1 once type t has been included by header i, so the
+  // dedup set never needs clearing between headers.
+  usize *included =
+      arena_push<usize>(arena, parse->struct_count + parse->flags_count);
+
+  for (usize i = 0; i < sema->order_count; i++) {
+    TypeRef type = sema->order[i];
+    if (dirty && !dirty[type_slot(parse, type)])
+      continue;
+    GeneratedFile *file = &files[count++];
+    file->name = header_name(arena, type_name(parse, type), "");
+
+    str8_builder out(arena);
+    if (type.kind == TYPE_STRUCT) {
+      StructDecl *decl = &parse->structs[type.index];
+      gen_preamble(&out, decl, 1);
+
+      // Fields are held by value, so each dependency needs its full header.
+      bool any = false;
+      for (usize f = 0; f < decl->field_count; f++) {
+        TypeRef dep = decl->fields[f].type;
+        if (dep.kind != TYPE_STRUCT && dep.kind != TYPE_FLAGS)
+          continue;
+        usize slot = type_slot(parse, dep);
+        if (included[slot] == i + 1)
+          continue;
+        included[slot] = i + 1;
+        out.appendf("#include \"%.*s.h\"\n", GEN_STR8(type_name(parse, dep)));
+        any = true;
+      }
+      if (any) {
+        out.append("\n");
+      }
+    } else {
+      gen_preamble(&out, nullptr, 0);
+    }
+    gen_decl(&out, parse, type, errors);
+    file->contents = out.build();
+  }
+
+  GeneratedFile *fwd = &files[count++];
+  fwd->name = header_name(arena, name, "_fwd");
+  {
+    str8_builder out(arena);
+    out.append("#pragma once\n\n#include \"core/core.h\"\n\n");
+    for (usize i = 0; i < sema->order_count; i++) {
+      TypeRef type = sema->order[i];
+      if (type.kind == TYPE_STRUCT) {
+        out.appendf("struct %.*s;\n", GEN_STR8(type_name(parse, type)));
+      } else {
+        out.appendf("enum class %.*s : " FLAGS_STORAGE_TYPE ";\n",
+                    GEN_STR8(type_name(parse, type)));
+      }
+    }
+    fwd->contents = out.build();
+  }
+
+  GeneratedFile *umbrella = &files[count++];
+  umbrella->name = header_name(arena, name, "");
+  {
+    str8_builder out(arena);
+    out.append("#pragma once\n\n");
+    for (usize i = 0; i < sema->order_count; i++) {
+      out.appendf("#include \"%.*s.h\"\n",
+                  GEN_STR8(type_name(parse, sema->order[i])));
+    }
+    umbrella->contents = out.build();
+  }
+
+  return {files, count};
+}
@@ -0,0 +1,122 @@
+#include "gen/gen.h"
+
+// See runtime/serialize.h for the wire format.
+
+static void gen_serialize_packed(str8_builder *out, StructDecl *decl,
+                                 usize size) {
+  out->appendf(
+      "static_assert(std::is_trivially_copyable_v<%.*s>);\n"
+      "static_assert(sizeof(%.*s) == %zu, \"%.*s must have no padding\");\n"
+      "static_assert(std::endian::native == std::endian::little,\n"
+      "              \"packed serialization of %.*s assumes little-endian\");\n"
+      "\n"
+      "inline usize serialized_size(const %.*s &) {\n"
+      "  return PACKED_HEADER_SIZE + sizeof(%.*s);\n"
+      "}\n"
+      "inline usize serialize_to(u8 *out, const %.*s &value) {\n"
+      "  return packed_store(out, &value, sizeof(%.*s));\n"
+      "}\n"
+      "inline bool deserialize(str8 in, %.*s *out) {\n"
+      "  return packed_load(in, out, sizeof(%.*s));\n"
+      "}\n\n",
+      GEN_STR8(decl->name), GEN_STR8(decl->name), size, GEN_STR8(decl->name),
+      GEN_STR8(decl->name), GEN_STR8(decl->name), GEN_STR8(decl->name),
+      GEN_STR8(decl->name), GEN_STR8(decl->name), GEN_STR8(decl->name),
+      GEN_STR8(decl->name));
+}
+
+static void gen_serialize_table(str8_builder *out, StructDecl *decl) {
+  // serialized_size walks the fields exactly like serialize_to so both agree
+  // on alignment padding.
+  out->appendf("inline usize serialized_size([[maybe_unused]] const %.*s "
+               "&value) {\n"
+               "  usize size = TABLE_HEADER_SIZE + 4 * %zu;\n",
+               GEN_STR8(decl->name), decl->field_count);
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    if (gen_scalar_type(field)) {
+      out->appendf("  size = ALIGN_UP(size, sizeof(%.*s)) + sizeof(%.*s);\n",
+                   GEN_STR8(field->type_name), GEN_STR8(field->type_name));
+    } else {
+      out->appendf("  size = ALIGN_UP(size, 4) + 4 + "
+                   "serialized_size(value.%.*s);\n",
+                   GEN_STR8(field->field_name));
+    }
+  }
+  out->append("  return size;\n}\n\n");
+
+  out->appendf("inline usize serialize_to(u8 *out, const %.*s &value) {\n"
+               "  usize pos = TABLE_HEADER_SIZE + 4 * %zu;\n",
+               GEN_STR8(decl->name), decl->field_count);
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    if (gen_scalar_type(field)) {
+      out->appendf("  pos = ALIGN_UP(pos, sizeof(%.*s));\n"
+                   "  le_store<u32>(out + TABLE_HEADER_SIZE + 4 * %zu, u32(pos));\n"
+                   "  le_store<%.*s>(out + pos, value.%.*s);\n"
+                   "  pos += sizeof(%.*s);\n",
+                   GEN_STR8(field->type_name), i, GEN_STR8(field->type_name),
+                   GEN_STR8(field->field_name), GEN_STR8(field->type_name));
+    } else {
+      out->appendf("  pos = ALIGN_UP(pos, 4);\n"
+                   "  le_store<u32>(out + TABLE_HEADER_SIZE + 4 * %zu, u32(pos));\n"
+                   "  {\n"
+                   "    usize len = serialize_to(out + pos + 4, value.%.*s);\n"
+                   "    le_store<u32>(out + pos, u32(len));\n"
+                   "    pos += 4 + len;\n"
+                   "  }\n",
+                   i, GEN_STR8(field->field_name));
+    }
+  }
+  out->appendf("  table_store_header(out, %zu, pos);\n"
+               "  return pos;\n}\n\n",
+               decl->field_count);
+
+  out->appendf("inline bool deserialize(str8 in, %.*s *out) {\n"
+               "  if (!table_valid(in))\n"
+               "    return false;\n",
+               GEN_STR8(decl->name));
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    if (gen_scalar_type(field)) {
+      out->appendf("  out->%.*s = table_load<%.*s>(in, %zu);\n",
+                   GEN_STR8(field->field_name), GEN_STR8(field->type_name), i);
+    } else {
+      out->appendf("  out->%.*s = {};\n"
+                   "  if (str8 blob = table_blob(in, %zu); blob.len)\n"
+                   "    deserialize(blob, &out->%.*s);\n",
+                   GEN_STR8(field->field_name), i,
+                   GEN_STR8(field->field_name));
+    }
+  }
+  out->append("  return true;\n}\n\n");
+
+  // In-place accessors over a serialized buffer, e.g. an mmap'd file. The
+  // buffer and valid() live in the TableView base, so accessors for fields
+  // named `data` or `valid` merely hide them.
+  out->appendf("struct %.*sView : TableView {\n", GEN_STR8(decl->name));
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    if (gen_scalar_type(field)) {
+      out->appendf("  %.*s %.*s() const {\n"
+                   "    return table_load<%.*s>(TableView::data, %zu);\n"
+                   "  }\n",
+                   GEN_STR8(field->type_name), GEN_STR8(field->field_name),
+                   GEN_STR8(field->type_name), i);
+    } else {
+      out->appendf("  str8 %.*s() const {\n"
+                   "    return table_blob(TableView::data, %zu);\n"
+                   "  }\n",
+                   GEN_STR8(field->field_name), i);
+    }
+  }
+  out->append("};\n\n");
+}
+
+void gen_serialize(str8_builder *out, StructDecl *decl) {
+  if (usize size = gen_packed_size(decl)) {
+    gen_serialize_packed(out, decl, size);
+  } else {
+    gen_serialize_table(out, decl);
+  }
+}
@@ -0,0 +1,158 @@
+#include "gen/gen.h"
+
+// Every field array starts on a cache line and capacities are kept multiples
+// of SOA_ALIGN elements, so a SIMD loop may load whole vectors past `count`
+// without leaving the allocation.
+#define SOA_ALIGN 64
+
+// The field arrays live in a nested `columns` struct and Ref names its own
+// members through `this`, so field names don't clash with the container's
+// members, methods or parameters. The one exception is a field named `Ref`,
+// which would hide Ref's own name inside it; gen_soa_check reports those.
+// Field types that are schema types are qualified with `::`, so a type named
+// like one of the nested structs still means the schema type.
+void gen_soa_check(Arena *arena, StructDecl *decl, ErrorList *errors) {
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    if (field->field_name.equal("Ref"_u8)) {
+      str8_builder message(arena);
+      message.appendf("Field 'Ref' clashes with %.*sSoA::Ref, generated by "
+                      "'soa'",
+                      GEN_STR8(decl->name));
+      add_error(errors, message.build(), field->location);
+    }
+  }
+}
+
+// Prefix that makes a field type name refer to the schema type.
+static const char *soa_scope(FieldDecl *field) {
+  return field->type.kind == TYPE_STRUCT || field->type.kind == TYPE_FLAGS
+             ? "::"
+             : "";
+}
+
+static void gen_soa_ref_assign(str8_builder *out, StructDecl *decl,
+                               str8 source) {
+  out->appendf("    Ref &operator=(const %.*s &value) {\n", GEN_STR8(source));
+  for (usize i = 0; i < decl->field_count; i++) {
+    out->appendf("      this->%.*s = value.%.*s;\n",
+                 GEN_STR8(decl->fields[i].field_name),
+                 GEN_STR8(decl->fields[i].field_name));
+  }
+  out->append("      return *this;\n    }\n");
+}
+
+static void gen_soa_ref(str8_builder *out, StructDecl *decl) {
+  out->append("  struct Ref {\n");
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    out->appendf("    %s%.*s &%.*s;\n", soa_scope(field),
+                 GEN_STR8(field->type_name), GEN_STR8(field->field_name));
+  }
+
+  out->appendf("\n    operator %.*s() const {\n      return %.*s{",
+               GEN_STR8(decl->name), GEN_STR8(decl->name));
+  for (usize i = 0; i < decl->field_count; i++) {
+    out->appendf("%sthis->%.*s", i ? ", " : "",
+                 GEN_STR8(decl->fields[i].field_name));
+  }
+  out->append("};\n    }\n");
+
+  gen_soa_ref_assign(out, decl, decl->name);
+  // Reference members delete the implicit copy assignment; assigning one
+  // element to another (`soa[i] = soa[j]`) copies the values instead.
+  gen_soa_ref_assign(out, decl, "Ref"_u8);
+  out->append("  };\n\n");
+}
+
+static void gen_soa_iterator(str8_builder *out, StructDecl *decl) {
+  out->appendf("  struct Iterator {\n"
+               "    %.*sSoA *soa;\n"
+               "    usize index;\n"
+               "\n"
+               "    Ref operator*() const { return (*soa)[index]; }\n"
+               "    Iterator &operator++() {\n"
+               "      index++;\n"
+               "      return *this;\n"
+               "    }\n"
+               "    bool operator!=(const Iterator &other) const {\n"
+               "      return index != other.index;\n"
+               "    }\n"
+               "  };\n\n",
+               GEN_STR8(decl->name));
+}
+
+void gen_soa(str8_builder *out, StructDecl *decl) {
+  out->appendf("struct %.*sSoA {\n", GEN_STR8(decl->name));
+  out->appendf("  static constexpr usize align = %d;\n\n", SOA_ALIGN);
+  out->append("  struct Columns {\n");
+  for (usize i = 0; i < decl->field_count; i++) {
+    FieldDecl *field = &decl->fields[i];
+    out->appendf("    %s%.*s *%.*s = nullptr;\n", soa_scope(field),
+                 GEN_STR8(field->type_name), GEN_STR8(field->field_name));
+  }
+  out->append("  };\n\n"
+              "  Arena *arena;\n"
+              "  usize count = 0;\n"
+              "  usize capacity = 0;\n"
+              "  Columns columns;\n");
+  out->appendf("\n  %.*sSoA(Arena *arena_) : arena(arena_) {}\n\n",
+               GEN_STR8(decl->name));
+
+  gen_soa_ref(out, decl);
+  gen_soa_iterator(out, decl);
+
+  out->append("  Ref operator[](usize i) { return Ref{");
+  for (usize i = 0; i < decl->field_count; i++) {
+    out->appendf("%scolumns.%.*s[i]", i ? ", " : "",
+                 GEN_STR8(decl->fields[i].field_name));
+  }
+  out->append("}; }\n"
+              "  Iterator begin() { return {this, 0}; }\n"
+              "  Iterator end() { return {this, count}; }\n\n");
+
+  // The arena cannot grow an allocation in place: growing moves every array
+  // to a fresh block and leaves the old ones to be reclaimed with the arena.
+  out->append("  template <class T> T *grow(T *column, usize new_capacity) {\n"
+              "    static_assert(std::is_trivially_copyable_v<T>);\n"
+              "    T *grown = (T *)arena_push(arena, new_capacity * sizeof(T), "
+              "align);\n"
+              "    if (count)\n"
+              "      std::memcpy(grown, column, count * sizeof(T));\n"
+              "    return grown;\n"
+              "  }\n\n"
+              "  void reserve(usize new_capacity) {\n"
+              "    if (new_capacity <= capacity)\n"
+              "      return;\n"
+              "    new_capacity = ALIGN_UP(new_capacity, align);\n");
+  for (usize i = 0; i < decl->field_count; i++) {
+    out->appendf("    columns.%.*s = grow(columns.%.*s, new_capacity);\n",
+                 GEN_STR8(decl->fields[i].field_name),
+                 GEN_STR8(decl->fields[i].field_name));
+  }
+  out->append("    capacity = new_capacity;\n  }\n\n");
+
+  out->appendf("  void push(const %.*s &value) {\n"
+               "    if (count == capacity)\n"
+               "      reserve(capacity ? capacity * 2 : align);\n",
+               GEN_STR8(decl->name));
+  for (usize i = 0; i < decl->field_count; i++) {
+    out->appendf("    columns.%.*s[count] = value.%.*s;\n",
+                 GEN_STR8(decl->fields[i].field_name),
+                 GEN_STR8(decl->fields[i].field_name));
+  }
+  out->append("    count++;\n  }\n\n");
+
+  // Swap-remove: O(1) per field but does not preserve order.
+  out->appendf("  void remove(usize i) {\n"
+               "    CHECK(i < count, \"%.*sSoA::remove: index %%zu out of "
+               "range (count=%%zu)\", i, count);\n"
+               "    count--;\n",
+               GEN_STR8(decl->name));
+  for (usize i = 0; i < decl->field_count; i++) {
+    out->appendf("    columns.%.*s[i] = columns.%.*s[count];\n",
+                 GEN_STR8(decl->fields[i].field_name),
+                 GEN_STR8(decl->fields[i].field_name));
+  }
+  out->append("  }\n};\n\n");
+}
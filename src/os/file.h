@@ -0,0 +1,26 @@
+// IWYU pragma: private, include "os/os.h"
+
+#include "core/core.h"
+
+struct FileContents {
+  str8 data;
+  bool ok;
+};
+
+// Reads a whole file into `arena`.
+FileContents os_read_file(Arena *arena, const char *path);
+bool os_write_file(const char *path, str8 data);
+
+struct FileStream;
+
+// Sequential reads, for files too large to hold in memory at once.
+FileStream *os_stream_open(const char *path);
+// Reads up to `size` bytes. Returns how many were read, 0 at the end of the
+// file, or -1 on error.
+i64 os_stream_read(FileStream *stream, u8 *dest, usize size);
+void os_stream_close(FileStream *stream);
+// Succeeds if the directory exists afterwards. Parents are not created.
+bool os_make_directory(const char *path);
+// Paths ("<dir>/<name>", null-terminated) of the regular files in `dir`, in
+// no particular order.
+str8_list *os_list_directory(Arena *arena, const char *dir);
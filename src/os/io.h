@@ -0,0 +1,26 @@
+// IWYU pragma: private, include "os/os.h"
+
+#include "core/core.h"
+
+// Batched whole-file I/O. The opens, reads, writes and closes of many files
+// are submitted together (io_uring on Linux), so regenerating thousands of
+// small files costs a few system calls per batch instead of several per file.
+// Falls back to one file at a time with pread/pwrite when batching is
+// unavailable.
+
+struct FileRead {
+  const char *path;
+  // Receives the contents.
+  Arena *arena;
+  str8 data;
+  bool ok;
+};
+
+struct FileWrite {
+  const char *path;
+  str8 data;
+  bool ok;
+};
+
+void os_read_files(FileRead *reads, usize count);
+void os_write_files(FileWrite *writes, usize count);
@@ -0,0 +1,127 @@
+#include <cerrno>
+#include <cstdlib>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core/core.h"
+#include "os/os.h"
+
+// Reads until end of file rather than trusting the stat size: pipes and
+// procfs files report 0, and the file may change while it is read. The buffer
+// grows in place, so nothing else may be pushed to `arena` meanwhile.
+FileContents os_read_file(Arena *arena, const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return {{}, false};
+  defer { close(fd); };
+
+  struct stat st;
+  if (fstat(fd, &st) < 0)
+    return {{}, false};
+
+  usize start = arena_pos(arena);
+  // One spare byte, so a file matching its stat size is done after the read
+  // that finds the end.
+  usize capacity = usize(st.st_size) + 1;
+  if (capacity < KB(4)) {
+    capacity = KB(4);
+  }
+  u8 *data = (u8 *)arena_push(arena, capacity, 1);
+  usize size = 0;
+  for (;;) {
+    if (size == capacity) {
+      arena_push(arena, capacity, 1);
+      capacity *= 2;
+    }
+    ssize_t n = read(fd, data + size, capacity - size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0) {
+      arena_pop_to(arena, start);
+      return {{}, false};
+    }
+    if (n == 0)
+      break;
+    size += usize(n);
+  }
+  // Byte aligned, so the data starts right at `start`.
+  arena_pop_to(arena, start + size);
+  return {{data, size}, true};
+}
+
+bool os_write_file(const char *path, str8 data) {
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return false;
+  defer { close(fd); };
+
+  usize done = 0;
+  while (done < data.len) {
+    ssize_t n = pwrite(fd, data.data + done, data.len - done, off_t(done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    done += usize(n);
+  }
+  return true;
+}
+
+struct FileStream {
+  int fd;
+};
+
+FileStream *os_stream_open(const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return nullptr;
+  // Lets the kernel read further ahead.
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  FileStream *stream = (FileStream *)calloc(1, sizeof(FileStream));
+  stream->fd = fd;
+  return stream;
+}
+
+i64 os_stream_read(FileStream *stream, u8 *dest, usize size) {
+  for (;;) {
+    ssize_t n = read(stream->fd, dest, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    return n;
+  }
+}
+
+void os_stream_close(FileStream *stream) {
+  close(stream->fd);
+  free(stream);
+}
+
+bool os_make_directory(const char *path) {
+  return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+str8_list *os_list_directory(Arena *arena, const char *dir) {
+  DIR *handle = opendir(dir);
+  if (!handle)
+    return nullptr;
+  defer { closedir(handle); };
+
+  str8_list *head = nullptr;
+  while (dirent *entry = readdir(handle)) {
+    if (entry->d_type != DT_REG && entry->d_type != DT_UNKNOWN)
+      continue;
+
+    str8_builder path(arena);
+    path.appendf("%s/%s", dir, entry->d_name);
+    str8 built = path.build(true);
+
+    str8_list *node = arena_push<str8_list>(arena);
+    node->data = {built.data, built.len - 1};
+    node->next = head;
+    head = node;
+  }
+  return head;
+}
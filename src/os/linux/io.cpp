@@ -0,0 +1,405 @@
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "core/core.h"
+#include "os/os.h"
+
+// Files handled per round trip; each step of a batch (open, stat, read,
+// write, close) takes at most one entry per file.
+#define IO_BATCH 128
+#define IO_RING_ENTRIES IO_BATCH
+// READ and WRITE lengths are 32 bits and the kernel transfers at most about
+// 2 GiB per call anyway, so larger files take several entries.
+#define IO_MAX_TRANSFER GB(1)
+// io_uring_enter fails with EAGAIN or EBUSY while the kernel is short on
+// memory or the completion queue is full; give up after this many in a row.
+#define IO_ENTER_RETRIES 64
+
+struct IoRing {
+  int fd;
+  u32 *sq_tail;
+  u32 sq_mask;
+  u32 *sq_array;
+  io_uring_sqe *sqes;
+  u32 *cq_head;
+  u32 *cq_tail;
+  u32 cq_mask;
+  io_uring_cqe *cqes;
+  u32 pending;
+
+  void *ring_ptr;
+  usize ring_size;
+  usize sqes_size;
+};
+
+// Kernels before 5.6 can set up a ring but fail the opcodes used here with
+// -EINVAL. They cannot be probed either, so a failed probe means no ring.
+static bool io_ring_supported(int fd) {
+  alignas(io_uring_probe) u8 buffer[sizeof(io_uring_probe) +
+                                    256 * sizeof(io_uring_probe_op)] = {};
+  io_uring_probe *probe = (io_uring_probe *)buffer;
+  if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) <
+      0)
+    return false;
+
+  u8 needed[] = {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ,
+                 IORING_OP_WRITE, IORING_OP_CLOSE};
+  for (u8 op : needed) {
+    if (op >= probe->ops_len || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED))
+      return false;
+  }
+  return true;
+}
+
+static bool io_ring_init(IoRing *ring) {
+  io_uring_params params = {};
+  int fd = int(syscall(__NR_io_uring_setup, IO_RING_ENTRIES, &params));
+  if (fd < 0)
+    return false;
+
+  if (!io_ring_supported(fd)) {
+    close(fd);
+    return false;
+  }
+
+  // Older kernels map the two rings separately; not worth supporting here.
+  if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    close(fd);
+    return false;
+  }
+
+  usize sq_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+  usize cq_size =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  usize ring_size = sq_size > cq_size ? sq_size : cq_size;
+  u8 *ptr = (u8 *)mmap(nullptr, ring_size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (ptr == MAP_FAILED) {
+    close(fd);
+    return false;
+  }
+
+  usize sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+  void *sqes = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    munmap(ptr, ring_size);
+    close(fd);
+    return false;
+  }
+
+  *ring = IoRing{
+      .fd = fd,
+      .sq_tail = (u32 *)(ptr + params.sq_off.tail),
+      .sq_mask = *(u32 *)(ptr + params.sq_off.ring_mask),
+      .sq_array = (u32 *)(ptr + params.sq_off.array),
+      .sqes = (io_uring_sqe *)sqes,
+      .cq_head = (u32 *)(ptr + params.cq_off.head),
+      .cq_tail = (u32 *)(ptr + params.cq_off.tail),
+      .cq_mask = *(u32 *)(ptr + params.cq_off.ring_mask),
+      .cqes = (io_uring_cqe *)(ptr + params.cq_off.cqes),
+      .pending = 0,
+      .ring_ptr = ptr,
+      .ring_size = ring_size,
+      .sqes_size = sqes_size,
+  };
+  return true;
+}
+
+static void io_ring_destroy(IoRing *ring) {
+  munmap(ring->sqes, ring->sqes_size);
+  munmap(ring->ring_ptr, ring->ring_size);
+  close(ring->fd);
+}
+
+static io_uring_sqe *io_ring_push(IoRing *ring, u8 opcode, u64 user_data) {
+  u32 tail = *ring->sq_tail + ring->pending;
+  u32 index = tail & ring->sq_mask;
+  io_uring_sqe *sqe = &ring->sqes[index];
+  *sqe = {};
+  sqe->opcode = opcode;
+  sqe->user_data = user_data;
+  ring->sq_array[index] = index;
+  ring->pending++;
+  return sqe;
+}
+
+// Submits everything pushed so far and calls `on_complete(user_data, res)`
+// once per entry. `res` is the syscall result, or -errno. On failure it still
+// waits for what was submitted, so no entry is left pointing at the caller's
+// buffers; the ring must then be destroyed.
+template <class F> static bool io_ring_run(IoRing *ring, F &&on_complete) {
+  u32 count = ring->pending;
+  if (count == 0)
+    return true;
+
+  std::atomic_ref<u32>(*ring->sq_tail)
+      .store(*ring->sq_tail + count, std::memory_order_release);
+  ring->pending = 0;
+
+  u32 submitted = 0;
+  u32 completed = 0;
+  u32 retries = 0;
+  bool ok = true;
+  while (completed < (ok ? count : submitted)) {
+    u32 to_submit = ok ? count - submitted : 0;
+    long res = syscall(__NR_io_uring_enter, ring->fd, to_submit, 1,
+                       IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (res < 0 && errno != EINTR) {
+      bool transient = errno == EAGAIN || errno == EBUSY || errno == ENOMEM;
+      if (!transient || ++retries > IO_ENTER_RETRIES) {
+        // Nothing can be waited for either: the entries die with the ring.
+        if (!ok)
+          return false;
+        ok = false;
+      }
+    } else {
+      retries = 0;
+    }
+    if (res > 0)
+      submitted += u32(res);
+
+    u32 head = *ring->cq_head;
+    u32 tail =
+        std::atomic_ref<u32>(*ring->cq_tail).load(std::memory_order_acquire);
+    for (; head != tail; head++, completed++) {
+      io_uring_cqe *cqe = &ring->cqes[head & ring->cq_mask];
+      on_complete(cqe->user_data, cqe->res);
+    }
+    std::atomic_ref<u32>(*ring->cq_head).store(head, std::memory_order_release);
+  }
+  return ok;
+}
+
+// Closed descriptors are reset to -1, so after a failure io_close_direct
+// closes only the others.
+static bool io_close_all(IoRing *ring, int *fds, usize count) {
+  for (usize i = 0; i < count; i++) {
+    if (fds[i] >= 0) {
+      io_uring_sqe *sqe = io_ring_push(ring, IORING_OP_CLOSE, i);
+      sqe->fd = fds[i];
+    }
+  }
+  return io_ring_run(ring, [&](u64 i, i32) { fds[i] = -1; });
+}
+
+// After a failed io_ring_run the ring cannot be trusted, not even to close.
+static void io_close_direct(int *fds, usize count) {
+  for (usize i = 0; i < count; i++) {
+    if (fds[i] >= 0) {
+      close(fds[i]);
+    }
+  }
+}
+
+// Returns false if the ring failed. The batch is then undone: every file is
+// closed and marked not ok and the buffers are popped, so it can be read again
+// without the ring.
+static bool io_read_batch(IoRing *ring, FileRead *reads, usize count) {
+  int fds[IO_BATCH];
+  usize marks[IO_BATCH];
+  struct statx stats[IO_BATCH];
+  bool stat_ok[IO_BATCH] = {};
+  usize done[IO_BATCH] = {};
+  // Files whose size is unknown are read after the batch, until end of file.
+  bool sequential[IO_BATCH] = {};
+
+  for (usize i = 0; i < count; i++) {
+    fds[i] = -1;
+    reads[i].ok = false;
+
+    io_uring_sqe *open = io_ring_push(ring, IORING_OP_OPENAT, i);
+    open->fd = AT_FDCWD;
+    open->addr = u64(reads[i].path);
+    open->open_flags = O_RDONLY | O_CLOEXEC;
+  }
+  bool ok = io_ring_run(ring, [&](u64 i, i32 res) { fds[i] = res; });
+
+  // Stat what was opened: the path may have been replaced by an editor's
+  // atomic rename in between.
+  if (ok) {
+    for (usize i = 0; i < count; i++) {
+      if (fds[i] < 0)
+        continue;
+      io_uring_sqe *stat = io_ring_push(ring, IORING_OP_STATX, i);
+      stat->fd = fds[i];
+      stat->addr = u64("");
+      stat->statx_flags = AT_EMPTY_PATH;
+      stat->len = STATX_TYPE | STATX_SIZE;
+      stat->off = u64(&stats[i]);
+    }
+    ok = io_ring_run(ring, [&](u64 i, i32 res) { stat_ok[i] = res == 0; });
+  }
+
+  for (usize i = 0; i < count; i++) {
+    marks[i] = arena_pos(reads[i].arena);
+  }
+  if (ok) {
+    for (usize i = 0; i < count; i++) {
+      if (fds[i] < 0 || !stat_ok[i])
+        continue;
+      // Pipes and procfs files report a size of 0.
+      usize size = usize(stats[i].stx_size);
+      if (!S_ISREG(stats[i].stx_mode) || size == 0) {
+        sequential[i] = true;
+        continue;
+      }
+      reads[i].data = {(u8 *)arena_push(reads[i].arena, size, 1), size};
+      reads[i].ok = true;
+    }
+  }
+
+  // Short reads are resubmitted until every file is complete or failed.
+  while (ok) {
+    for (usize i = 0; i < count; i++) {
+      if (reads[i].ok && done[i] < reads[i].data.len) {
+        io_uring_sqe *sqe = io_ring_push(ring, IORING_OP_READ, i);
+        sqe->fd = fds[i];
+        usize left = reads[i].data.len - done[i];
+        sqe->addr = u64(reads[i].data.data + done[i]);
+        sqe->len = u32(left < IO_MAX_TRANSFER ? left : IO_MAX_TRANSFER);
+        sqe->off = done[i];
+      }
+    }
+    if (ring->pending == 0)
+      break;
+    ok = io_ring_run(ring, [&](u64 i, i32 res) {
+      if (res > 0) {
+        done[i] += usize(res);
+      } else if (res < 0 && res != -EINTR && res != -EAGAIN) {
+        reads[i].ok = false;
+      } else if (res == 0) {
+        // The file shrank since statx.
+        reads[i].data.len = done[i];
+      }
+    });
+  }
+
+  if (ok) {
+    ok = io_close_all(ring, fds, count);
+  }
+  if (!ok) {
+    io_close_direct(fds, count);
+    // Every mark predates every push, so this holds for shared arenas too.
+    for (usize i = 0; i < count; i++) {
+      arena_pop_to(reads[i].arena, marks[i]);
+      reads[i].data = {};
+      reads[i].ok = false;
+    }
+    return false;
+  }
+
+  for (usize i = 0; i < count; i++) {
+    if (sequential[i]) {
+      FileContents contents = os_read_file(reads[i].arena, reads[i].path);
+      reads[i].data = contents.data;
+      reads[i].ok = contents.ok;
+    }
+  }
+  return true;
+}
+
+// Returns false if the ring failed; every file of the batch is then closed
+// and marked not ok, so it can be written again without the ring.
+static bool io_write_batch(IoRing *ring, FileWrite *writes, usize count) {
+  int fds[IO_BATCH];
+  usize done[IO_BATCH];
+
+  for (usize i = 0; i < count; i++) {
+    fds[i] = -1;
+    done[i] = 0;
+    io_uring_sqe *open = io_ring_push(ring, IORING_OP_OPENAT, i);
+    open->fd = AT_FDCWD;
+    open->addr = u64(writes[i].path);
+    open->len = 0644;
+    open->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  }
+  bool ok = io_ring_run(ring, [&](u64 i, i32 res) { fds[i] = res; });
+
+  for (usize i = 0; i < count; i++) {
+    writes[i].ok = fds[i] >= 0;
+  }
+
+  while (ok) {
+    for (usize i = 0; i < count; i++) {
+      if (writes[i].ok && done[i] < writes[i].data.len) {
+        io_uring_sqe *sqe = io_ring_push(ring, IORING_OP_WRITE, i);
+        sqe->fd = fds[i];
+        usize left = writes[i].data.len - done[i];
+        sqe->addr = u64(writes[i].data.data + done[i]);
+        sqe->len = u32(left < IO_MAX_TRANSFER ? left : IO_MAX_TRANSFER);
+        sqe->off = done[i];
+      }
+    }
+    if (ring->pending == 0)
+      break;
+    ok = io_ring_run(ring, [&](u64 i, i32 res) {
+      if (res > 0) {
+        done[i] += usize(res);
+      } else if (res != -EINTR && res != -EAGAIN) {
+        writes[i].ok = false;
+      }
+    });
+  }
+
+  if (ok) {
+    ok = io_close_all(ring, fds, count);
+  }
+  if (!ok) {
+    io_close_direct(fds, count);
+    for (usize i = 0; i < count; i++) {
+      writes[i].ok = false;
+    }
+  }
+  return ok;
+}
+
+// A failed batch leaves the ring in an unknown state, so that batch and the
+// ones after it fall back to plain syscalls.
+void os_read_files(FileRead *reads, usize count) {
+  IoRing ring;
+  bool use_ring = io_ring_init(&ring);
+  for (usize i = 0; i < count; i += IO_BATCH) {
+    usize batch = count - i < IO_BATCH ? count - i : IO_BATCH;
+    if (use_ring) {
+      if (io_read_batch(&ring, reads + i, batch))
+        continue;
+      io_ring_destroy(&ring);
+      use_ring = false;
+    }
+    for (usize j = i; j < i + batch; j++) {
+      FileContents contents = os_read_file(reads[j].arena, reads[j].path);
+      reads[j].data = contents.data;
+      reads[j].ok = contents.ok;
+    }
+  }
+  if (use_ring) {
+    io_ring_destroy(&ring);
+  }
+}
+
+void os_write_files(FileWrite *writes, usize count) {
+  IoRing ring;
+  bool use_ring = io_ring_init(&ring);
+  for (usize i = 0; i < count; i += IO_BATCH) {
+    usize batch = count - i < IO_BATCH ? count - i : IO_BATCH;
+    if (use_ring) {
+      if (io_write_batch(&ring, writes + i, batch))
+        continue;
+      io_ring_destroy(&ring);
+      use_ring = false;
+    }
+    for (usize j = i; j < i + batch; j++) {
+      writes[j].ok = os_write_file(writes[j].path, writes[j].data);
+    }
+  }
+  if (use_ring) {
+    io_ring_destroy(&ring);
+  }
+}
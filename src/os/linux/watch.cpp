@@ -0,0 +1,102 @@
+#include <cerrno>
+#include <cstdlib>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "core/core.h"
+#include "os/os.h"
+
+struct FileWatch {
+  int fd;
+  // Directory path for each watch descriptor.
+  const char **dirs;
+  usize dir_count;
+};
+
+FileWatch *os_watch_create() {
+  int fd = inotify_init1(IN_CLOEXEC);
+  if (fd < 0)
+    return nullptr;
+
+  FileWatch *watch = (FileWatch *)calloc(1, sizeof(FileWatch));
+  watch->fd = fd;
+  return watch;
+}
+
+bool os_watch_add(FileWatch *watch, const char *dir) {
+  int wd = inotify_add_watch(watch->fd, dir,
+                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                 IN_DELETE);
+  if (wd < 0)
+    return false;
+
+  usize slot = usize(wd);
+  if (slot >= watch->dir_count) {
+    watch->dirs =
+        (const char **)realloc(watch->dirs, (slot + 1) * sizeof(char *));
+    for (usize i = watch->dir_count; i <= slot; i++) {
+      watch->dirs[i] = nullptr;
+    }
+    watch->dir_count = slot + 1;
+  }
+  watch->dirs[slot] = dir;
+  return true;
+}
+
+WatchEvent *os_watch_wait(FileWatch *watch, Arena *arena, u32 settle_ms) {
+  alignas(inotify_event) u8 buffer[KB(16)];
+  WatchEvent *head = nullptr;
+  WatchEvent **tail = &head;
+
+  int timeout = -1;
+  for (;;) {
+    pollfd pfd = {watch->fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, timeout);
+    if (ready < 0 && errno == EINTR)
+      continue;
+    if (ready < 0)
+      return nullptr;
+    if (ready == 0 && head)
+      return head;
+    if (ready == 0) {
+      // Only unnamed events so far: keep waiting for a real change.
+      timeout = -1;
+      continue;
+    }
+
+    ssize_t len = read(watch->fd, buffer, sizeof(buffer));
+    if (len < 0 && (errno == EINTR || errno == EAGAIN))
+      continue;
+    if (len <= 0)
+      return nullptr;
+
+    for (ssize_t pos = 0; pos < len;) {
+      inotify_event *event = (inotify_event *)(buffer + pos);
+      pos += ssize_t(sizeof(inotify_event) + event->len);
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        WatchEvent *node = arena_push<WatchEvent>(arena);
+        node->overflow = true;
+        *tail = node;
+        tail = &node->next;
+        continue;
+      }
+
+      usize slot = usize(event->wd);
+      if (event->len == 0 || slot >= watch->dir_count || !watch->dirs[slot])
+        continue;
+
+      str8_builder path(arena);
+      path.appendf("%s/%s", watch->dirs[slot], event->name);
+      str8 built = path.build(true);
+
+      WatchEvent *node = arena_push<WatchEvent>(arena);
+      node->path = {built.data, built.len - 1};
+      node->removed = event->mask & (IN_MOVED_FROM | IN_DELETE);
+      *tail = node;
+      tail = &node->next;
+    }
+    timeout = int(settle_ms);
+  }
+}
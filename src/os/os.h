@@ -2,7 +2,10 @@
 #define OS_H
 // IWYU pragma: begin_exports
 
+#include "file.h"
+#include "io.h"
 #include "memory.h"
+#include "watch.h"
 
 // IWYU pragma: end_exports
 #endif
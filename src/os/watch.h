@@ -0,0 +1,23 @@
+// IWYU pragma: private, include "os/os.h"
+
+#include "core/core.h"
+
+struct FileWatch;
+
+struct WatchEvent {
+  WatchEvent *next;
+  str8 path;
+  // The file was deleted or moved away; otherwise it was written or created.
+  bool removed;
+  // The kernel queue overflowed and events were lost; `path` is empty and
+  // every watched directory must be listed again.
+  bool overflow;
+};
+
+FileWatch *os_watch_create();
+bool os_watch_add(FileWatch *watch, const char *dir);
+
+// Blocks until a file in a watched directory changes, then keeps collecting
+// until nothing happened for `settle_ms`, so an editor's save burst comes back
+// as one batch. Returns nullptr on error.
+WatchEvent *os_watch_wait(FileWatch *watch, Arena *arena, u32 settle_ms);
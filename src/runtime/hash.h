@@ -0,0 +1,51 @@
+#ifndef RUNTIME_HASH_H
+#define RUNTIME_HASH_H
+
+// Support code for the `hash` generator: a multiply-rotate mixer fed 8 bytes
+// at a time, so a run of adjacent fields costs a handful of multiplies
+// instead of one std::hash call and combine per field.
+
+#include "core/core.h"
+#include <bit>
+#include <cstddef>
+#include <functional>
+
+#define HASH_K0 0x9E3779B97F4A7C15ull
+#define HASH_K1 0xBF58476D1CE4E5B9ull
+
+ALWAYS_INLINE u64 hash_mix(u64 h, u64 value) {
+  h ^= value * HASH_K0;
+  return std::rotl(h, 31) * HASH_K1;
+}
+
+ALWAYS_INLINE u64 hash_finish(u64 h) {
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDull;
+  h ^= h >> 33;
+  h *= 0xC4CEB9FE1A85EC53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+ALWAYS_INLINE u64 hash_bytes(u64 h, const void *data, usize len) {
+  const u8 *bytes = (const u8 *)data;
+  h = hash_mix(h, len);
+  for (; len >= 8; bytes += 8, len -= 8) {
+    u64 chunk;
+    std::memcpy(&chunk, bytes, 8);
+    h = hash_mix(h, chunk);
+  }
+  if (len) {
+    u64 tail = 0;
+    std::memcpy(&tail, bytes, len);
+    h = hash_mix(h, tail);
+  }
+  return h;
+}
+
+// 0.0 == -0.0, so both must hash the same.
+ALWAYS_INLINE u64 hash_float(u64 h, f64 value) {
+  return hash_mix(h, std::bit_cast<u64>(value == 0.0 ? 0.0 : value));
+}
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef RUNTIME_SERIALIZE_H
+#define RUNTIME_SERIALIZE_H
+
+// Support code for the `serialize` generator.
+//
+// Every buffer starts with a u32 tag naming its format, so a reader rejects
+// data written in the other one, e.g. after a padded field was appended to a
+// packed struct.
+//
+// Structs made only of builtin scalars with no padding are written packed:
+//
+//   u32 tag                 SERIALIZE_TAG_PACKED
+//   u32 size                sizeof the struct when it was written
+//   the struct's bytes
+//
+// A reader zero-fills what a shorter buffer lacks and ignores what a longer
+// one adds, so such structs may only evolve by appending fields that keep
+// them packed; removing, reordering or retyping a field misreads old data.
+//
+// Everything else uses a flat table that can be read in place:
+//
+//   u32 tag                 SERIALIZE_TAG_TABLE
+//   u32 total_size
+//   u16 slot_count
+//   u16 reserved
+//   u32 slots[slot_count]   byte offset of each field from the table start,
+//                           indexed by field id, 0 if the field is absent
+//   field data              little-endian scalars, or u32 length + blob for
+//                           nested structs
+//
+// Field ids are declaration order, so fields may only be appended: readers
+// see missing slots as default values and ignore slots they don't know.
+
+#include "core/core.h"
+#include <bit>
+
+// "DGP1" and "DGT1" in little-endian byte order.
+#define SERIALIZE_TAG_PACKED 0x31504744u
+#define SERIALIZE_TAG_TABLE 0x31544744u
+
+#define PACKED_HEADER_SIZE 8
+#define TABLE_HEADER_SIZE 12
+
+template <class T> ALWAYS_INLINE void le_store(u8 *dst, T value) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1) {
+    u8 bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    for (usize i = 0; i < sizeof(T); i++) {
+      dst[i] = bytes[sizeof(T) - 1 - i];
+    }
+  } else {
+    std::memcpy(dst, &value, sizeof(T));
+  }
+}
+
+template <class T> ALWAYS_INLINE T le_load(const u8 *src) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  T value;
+  if constexpr (std::endian::native == std::endian::big && sizeof(T) > 1) {
+    u8 bytes[sizeof(T)];
+    for (usize i = 0; i < sizeof(T); i++) {
+      bytes[i] = src[sizeof(T) - 1 - i];
+    }
+    std::memcpy(&value, bytes, sizeof(T));
+  } else {
+    std::memcpy(&value, src, sizeof(T));
+  }
+  return value;
+}
+
+inline usize packed_store(u8 *out, const void *value, usize size) {
+  le_store<u32>(out, SERIALIZE_TAG_PACKED);
+  le_store<u32>(out + 4, u32(size));
+  std::memcpy(out + PACKED_HEADER_SIZE, value, size);
+  return PACKED_HEADER_SIZE + size;
+}
+
+inline bool packed_load(str8 in, void *out, usize size) {
+  if (in.len < PACKED_HEADER_SIZE ||
+      le_load<u32>(in.data) != SERIALIZE_TAG_PACKED)
+    return false;
+  usize stored = le_load<u32>(in.data + 4);
+  if (stored > in.len - PACKED_HEADER_SIZE)
+    return false;
+  usize copied = stored < size ? stored : size;
+  std::memcpy(out, in.data + PACKED_HEADER_SIZE, copied);
+  std::memset((u8 *)out + copied, 0, size - copied);
+  return true;
+}
+
+// Writes the header once the fields are written and their end is known.
+inline void table_store_header(u8 *out, u16 slot_count, usize total_size) {
+  le_store<u32>(out, SERIALIZE_TAG_TABLE);
+  le_store<u32>(out + 4, u32(total_size));
+  le_store<u16>(out + 8, slot_count);
+  le_store<u16>(out + 10, 0);
+}
+
+// Returns false if `table` is not a table or is too short to hold the header
+// it announces.
+inline bool table_valid(str8 table) {
+  if (table.len < TABLE_HEADER_SIZE ||
+      le_load<u32>(table.data) != SERIALIZE_TAG_TABLE)
+    return false;
+  usize slot_count = le_load<u16>(table.data + 8);
+  return le_load<u32>(table.data + 4) <= table.len &&
+         TABLE_HEADER_SIZE + 4 * slot_count <= table.len;
+}
+
+// Offset of field `id`, or 0 if the writer did not know about it.
+inline u32 table_slot(str8 table, u16 id) {
+  if (!table_valid(table) || id >= le_load<u16>(table.data + 8))
+    return 0;
+  return le_load<u32>(table.data + TABLE_HEADER_SIZE + 4 * usize(id));
+}
+
+template <class T> T table_load(str8 table, u16 id) {
+  u32 offset = table_slot(table, id);
+  if (offset == 0 || offset + sizeof(T) > table.len)
+    return T{};
+  return le_load<T>(table.data + offset);
+}
+
+inline str8 table_blob(str8 table, u16 id) {
+  u32 offset = table_slot(table, id);
+  if (offset == 0 || usize(offset) + 4 > table.len)
+    return {};
+  u32 len = le_load<u32>(table.data + offset);
+  if (usize(offset) + 4 + len > table.len)
+    return {};
+  return str8_span(table, usize(offset) + 4, len);
+}
+
+// Base of the generated <Type>View accessors.
+struct TableView {
+  str8 data;
+
+  bool valid() const { return table_valid(data); }
+};
+
+// Generated code provides serialized_size and serialize_to for each type.
+template <class T> str8 serialize(Arena *arena, const T &value) {
+  usize size = serialized_size(value);
+  u8 *data = arena_push<u8>(arena, size);
+  serialize_to(data, value);
+  return {data, size};
+}
+
+#endif
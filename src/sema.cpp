@@ -0,0 +1,237 @@
+#include "sema.h"
+#include <cstdarg>
+
+static BuiltinType builtin_types[] = {
+    {"bool"_u8, 1, false}, {"char"_u8, 1, false}, {"int"_u8, 4, false},
+    {"float"_u8, 4, true}, {"double"_u8, 8, true}, {"u8"_u8, 1, false},
+    {"u16"_u8, 2, false},  {"u32"_u8, 4, false},  {"u64"_u8, 8, false},
+    {"i8"_u8, 1, false},   {"i16"_u8, 2, false},  {"i32"_u8, 4, false},
+    {"i64"_u8, 8, false},  {"f32"_u8, 4, true},   {"f64"_u8, 8, true},
+};
+
+#define BUILTIN_TYPE_COUNT (sizeof(builtin_types) / sizeof(builtin_types[0]))
+
+BuiltinType *find_builtin_type(str8 name) {
+  for (auto &type : builtin_types) {
+    if (type.name.equal(name)) {
+      return &type;
+    }
+  }
+  return nullptr;
+}
+
+BuiltinType *builtin_type(u32 index) {
+  CHECK(index < BUILTIN_TYPE_COUNT, "Invalid builtin type index %u", index);
+  return &builtin_types[index];
+}
+
+// Linear probing stays short up to three quarters full.
+static usize type_index_capacity(usize count) {
+  usize capacity = 16;
+  while (capacity * 3 < count * 4) {
+    capacity *= 2;
+  }
+  return capacity;
+}
+
+TypeIndex type_index_make(usize count) {
+  usize capacity = type_index_capacity(count);
+  usize size = capacity * sizeof(TypeIndexSlot);
+  ArenaCreationInfo info{.commit_size = sizeof(Arena) + size,
+                         .reserve_size = sizeof(Arena) + size + KB(4)};
+  Arena *arena = arena_alloc(&info);
+  return {arena, arena_push<TypeIndexSlot>(arena, capacity), capacity - 1, 0};
+}
+
+void type_index_release(TypeIndex *index) { arena_release(index->arena); }
+
+TypeIndexSlot *type_index_find(TypeIndex *index, str8 name) {
+  usize i = str8_hash(name) & index->mask;
+  while (index->slots[i].type.kind != TYPE_UNRESOLVED &&
+         !index->slots[i].name.equal(name)) {
+    i = (i + 1) & index->mask;
+  }
+  return &index->slots[i];
+}
+
+TypeIndexSlot *type_index_add(TypeIndex *index, str8 name, TypeRef type) {
+  if (type_index_capacity(index->count + 1) > index->mask + 1) {
+    TypeIndex grown = type_index_make(index->count + 1);
+    for (usize i = 0; i <= index->mask; i++) {
+      TypeIndexSlot *slot = &index->slots[i];
+      if (slot->type.kind != TYPE_UNRESOLVED) {
+        *type_index_find(&grown, slot->name) = *slot;
+      }
+    }
+    grown.count = index->count;
+    type_index_release(index);
+    *index = grown;
+  }
+
+  TypeIndexSlot *slot = type_index_find(index, name);
+  if (slot->type.kind != TYPE_UNRESOLVED)
+    return slot;
+  *slot = {name, type};
+  index->count++;
+  return nullptr;
+}
+
+void type_index_add_builtins(TypeIndex *index) {
+  for (u32 i = 0; i < BUILTIN_TYPE_COUNT; i++) {
+    type_index_add(index, builtin_types[i].name, {TYPE_BUILTIN, i});
+  }
+}
+
+void sema_error(Arena *arena, ErrorList *errors, SourceLocation location,
+                const char *fmt, ...) {
+  str8_builder message(arena);
+  va_list args;
+  va_start(args, fmt);
+  message.append(fmt, args);
+  va_end(args);
+  add_error(errors, message.build(), location);
+}
+
+struct DeclInfo {
+  str8 name;
+  SourceLocation location;
+};
+
+static DeclInfo decl_info(ParseResult *parse, TypeRef type) {
+  switch (type.kind) {
+  case TYPE_STRUCT:
+    return {parse->structs[type.index].name,
+            parse->structs[type.index].location};
+  case TYPE_FLAGS:
+    return {parse->flags[type.index].name, parse->flags[type.index].location};
+  default:
+    return {builtin_types[type.index].name, {}};
+  }
+}
+
+static void declare(Arena *arena, ParseResult *parse, char **paths,
+                    TypeIndex *index, TypeRef type) {
+  DeclInfo info = decl_info(parse, type);
+  TypeIndexSlot *slot = type_index_add(index, info.name, type);
+  if (!slot)
+    return;
+  if (slot->type.kind == TYPE_BUILTIN) {
+    sema_error(arena, &parse->errors, info.location,
+               "Type '%.*s' redefines a builtin type", (int)info.name.len,
+               info.name.data);
+  } else {
+    SourceLocation first = decl_info(parse, slot->type).location;
+    sema_error(arena, &parse->errors, info.location,
+               "Duplicate type '%.*s' (first declared at %s:%u:%u)",
+               (int)info.name.len, info.name.data, paths[first.file],
+               first.line, first.column);
+  }
+}
+
+SemaResult analyze(Arena *arena, ParseResult *parse, char **paths) {
+  usize struct_count = parse->struct_count;
+  usize flags_count = parse->flags_count;
+  CHECK(struct_count + flags_count <= UINT32_MAX,
+        "Too many declarations: %zu", struct_count + flags_count);
+
+  TypeIndex index =
+      type_index_make(BUILTIN_TYPE_COUNT + struct_count + flags_count);
+  defer { type_index_release(&index); };
+  type_index_add_builtins(&index);
+  for (u32 i = 0; i < flags_count; i++) {
+    declare(arena, parse, paths, &index, {TYPE_FLAGS, i});
+
+    FlagsDecl *decl = &parse->flags[i];
+    if (decl->member_count > FLAGS_MAX_MEMBERS) {
+      sema_error(arena, &parse->errors, decl->location,
+                 "Flags '%.*s' has %zu members, at most %d are supported",
+                 (int)decl->name.len, decl->name.data, decl->member_count,
+                 FLAGS_MAX_MEMBERS);
+    }
+  }
+  for (u32 i = 0; i < struct_count; i++) {
+    declare(arena, parse, paths, &index, {TYPE_STRUCT, i});
+  }
+
+  // Resolve fields and count the by-value dependency edges between structs.
+  // `pending[s]` is the number of struct fields of `s` not yet emitted and
+  // `first_dependent` holds CSR offsets into `dependents` (shifted by one
+  // until the prefix sum below).
+  u32 *pending = arena_push<u32>(arena, struct_count);
+  u32 *first_dependent = arena_push<u32>(arena, struct_count + 1);
+  usize edge_count = 0;
+  for (usize s = 0; s < struct_count; s++) {
+    StructDecl *decl = &parse->structs[s];
+    for (usize f = 0; f < decl->field_count; f++) {
+      FieldDecl *field = &decl->fields[f];
+      TypeIndexSlot *slot = type_index_find(&index, field->type_name);
+      field->type = slot->type;
+      if (slot->type.kind == TYPE_UNRESOLVED) {
+        sema_error(arena, &parse->errors, field->location,
+                   "Unknown type '%.*s' for field '%.*s'",
+                   (int)field->type_name.len, field->type_name.data,
+                   (int)field->field_name.len, field->field_name.data);
+      } else if (slot->type.kind == TYPE_STRUCT) {
+        pending[s]++;
+        first_dependent[slot->type.index + 1]++;
+        edge_count++;
+      }
+    }
+  }
+
+  for (usize s = 0; s < struct_count; s++) {
+    first_dependent[s + 1] += first_dependent[s];
+  }
+  u32 *dependents = arena_push<u32>(arena, edge_count);
+  u32 *fill = arena_push<u32>(arena, struct_count);
+  for (u32 s = 0; s < struct_count; s++) {
+    StructDecl *decl = &parse->structs[s];
+    for (usize f = 0; f < decl->field_count; f++) {
+      TypeRef type = decl->fields[f].type;
+      if (type.kind == TYPE_STRUCT) {
+        dependents[first_dependent[type.index] + fill[type.index]++] = s;
+      }
+    }
+  }
+
+  // Kahn's algorithm, using `order` itself as the queue. Flags depend on
+  // nothing so they go first, then structs in source order as they become
+  // ready.
+  SemaResult result = {
+      .order = arena_push<TypeRef>(arena, struct_count + flags_count),
+      .order_count = 0,
+  };
+  for (u32 i = 0; i < flags_count; i++) {
+    result.order[result.order_count++] = {TYPE_FLAGS, i};
+  }
+  usize head = result.order_count;
+  for (u32 s = 0; s < struct_count; s++) {
+    if (pending[s] == 0) {
+      result.order[result.order_count++] = {TYPE_STRUCT, s};
+    }
+  }
+  while (head < result.order_count) {
+    u32 s = result.order[head++].index;
+    for (u32 e = first_dependent[s]; e < first_dependent[s + 1]; e++) {
+      u32 d = dependents[e];
+      if (--pending[d] == 0) {
+        result.order[result.order_count++] = {TYPE_STRUCT, d};
+      }
+    }
+  }
+
+  // Whatever is left sits on, or behind, a cycle of by-value fields. Keep
+  // them in source order so every declaration is still emitted once.
+  for (u32 s = 0; s < struct_count; s++) {
+    if (pending[s] != 0) {
+      StructDecl *decl = &parse->structs[s];
+      sema_error(arena, &parse->errors, decl->location,
+                 "Struct '%.*s' is part of, or depends on, a cycle of "
+                 "by-value fields",
+                 (int)decl->name.len, decl->name.data);
+      result.order[result.order_count++] = {TYPE_STRUCT, s};
+    }
+  }
+
+  return result;
+}
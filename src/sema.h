@@ -0,0 +1,69 @@
+#ifndef SEMA_H
+#define SEMA_H
+
+#include "ast.h"
+#include "core/core.h"
+
+// Scalar types known without any schema lookup.
+struct BuiltinType {
+  str8 name;
+  u32 size;
+  // Floats compare equal with different bytes (0.0 / -0.0) and unequal with
+  // identical ones (NaN), so they can't be compared as raw memory.
+  bool floating;
+};
+
+BuiltinType *find_builtin_type(str8 name);
+BuiltinType *builtin_type(u32 index);
+
+// Flags are stored as this builtin, so a flags type holds at most 32 members.
+#define FLAGS_STORAGE_TYPE "u32"
+#define FLAGS_MAX_MEMBERS 32
+
+// Maps type names to types with open addressing and linear probing; a slot is
+// empty while its type is TYPE_UNRESOLVED. Names are not copied. The slots
+// live in an arena of their own, so growing the index releases the old table.
+struct TypeIndexSlot {
+  str8 name;
+  TypeRef type;
+};
+
+struct TypeIndex {
+  Arena *arena;
+  TypeIndexSlot *slots;
+  usize mask;
+  usize count;
+};
+
+// Sized to hold `count` names without growing.
+TypeIndex type_index_make(usize count);
+void type_index_release(TypeIndex *index);
+// Returns the slot holding `name`, or the empty slot it would go in.
+TypeIndexSlot *type_index_find(TypeIndex *index, str8 name);
+// Adds `name`, growing the index when it gets too full. Returns nullptr once
+// added, or the slot that already holds `name`.
+TypeIndexSlot *type_index_add(TypeIndex *index, str8 name, TypeRef type);
+void type_index_add_builtins(TypeIndex *index);
+
+// Formats a message into `arena` and appends it to `errors`.
+PRINTF_LIKE(4, 5)
+void sema_error(Arena *arena, ErrorList *errors, SourceLocation location,
+                const char *fmt, ...);
+
+struct SemaResult {
+  // Every struct and flags declaration, ordered so that each type comes after
+  // all the types it contains by value.
+  TypeRef *order;
+  usize order_count;
+};
+
+// Resolves FieldDecl::type for every field of `parse` through a hash index of
+// all builtins, structs and flags, then orders the declarations by
+// dependency. Unknown, duplicate and self-containing types are reported to
+// parse->errors. `paths` names the input files by SourceLocation::file, for
+// messages that point at a second declaration. Runs in time linear in the
+// number of declarations and fields; everything it allocates lives in
+// `arena`.
+SemaResult analyze(Arena *arena, ParseResult *parse, char **paths);
+
+#endif
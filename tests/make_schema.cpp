@@ -0,0 +1,96 @@
+// Writes a large schema meant to trip up the split-point scanner: keywords
+// inside identifiers, declarations glued to the previous `}` or `)`, CRLF
+// line endings, tabs, and a struct larger than a parse chunk. All flags come
+// before the structs and every type is declared before use, so --stream must
+// produce the same output as a whole-file parse.
+//
+//   make_schema <path> <size in MB> [broken]
+//
+// `broken` sprinkles syntax and type errors over the same schema.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char *separators[] = {"\n", "\r\n", "\n\n\t", " ", ""};
+#define SEPARATOR_COUNT (sizeof(separators) / sizeof(separators[0]))
+
+static void write_flags(FILE *out, unsigned long i) {
+  fprintf(out, "flags%sflagship%lu {", i % 3 ? "\t" : " ", i);
+  for (unsigned long m = 0; m <= i % 5; m++) {
+    fprintf(out, "%s structs_%lu_%lu", m ? "," : "", i, m);
+  }
+  fprintf(out, "}%s", separators[i % SEPARATOR_COUNT]);
+}
+
+static void write_struct(FILE *out, unsigned long i, unsigned long flags_count,
+                         unsigned long field_count, bool broken) {
+  fprintf(out, "struct\r\nstructure%lu {\n", i);
+  fprintf(out, "  u32 flags_%lu,\n", i);
+  fprintf(out, "  flagship%lu flagsy,\n", i % flags_count);
+  // Nested fields need their type to list the same generators, and only
+  // structures 2, 6, 10... list all the nested ones.
+  if (i >= 3) {
+    fprintf(out, "\tstructure%lu struct_prev,\n", (i - 3) / 4 * 4 + 2);
+  }
+  if (broken && i % 97 == 13) {
+    fprintf(out, "  unknown_type%lu oops,\n", i);
+  }
+  if (broken && i % 89 == 7) {
+    fprintf(out, "  f32 missing_name,,\n");
+  }
+  for (unsigned long f = 0; f < field_count; f++) {
+    fprintf(out, "  %s generated%lu,\n", f % 2 ? "f64" : "i16", f);
+  }
+  fprintf(out, "  u8 last\n}");
+  if (broken && i % 101 == 50) {
+    fprintf(out, " $ ");
+  }
+  // Only some structs generate code, and a few use every generator so the
+  // includes of a whole-file parse match the ones --stream always writes.
+  switch (i % 4) {
+  case 0:
+    fprintf(out, " generates(hash)");
+    break;
+  case 1:
+    fprintf(out, "generates(serialize, hash)");
+    break;
+  case 2:
+    fprintf(out, "generates(soa, serialize, hash)");
+    break;
+  default:
+    break;
+  }
+  fprintf(out, "%s", separators[(i / 4) % SEPARATOR_COUNT]);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    fprintf(stderr, "usage: %s <path> <size in MB> [broken]\n", argv[0]);
+    return 2;
+  }
+  FILE *out = fopen(argv[1], "wb");
+  if (!out) {
+    fprintf(stderr, "error: cannot write %s\n", argv[1]);
+    return 1;
+  }
+  long size = atol(argv[2]) * 1024 * 1024;
+  bool broken = argc > 3 && strcmp(argv[3], "broken") == 0;
+
+  unsigned long flags_count = 0;
+  while (ftell(out) < size / 4) {
+    write_flags(out, flags_count++);
+  }
+  // One struct spans more than a parse chunk, so a split must skip past it.
+  write_struct(out, 0, flags_count, 400000, broken);
+  for (unsigned long i = 1; ftell(out) < size; i++) {
+    write_struct(out, i, flags_count, i % 7, broken);
+  }
+  fputs("\n", out);
+
+  if (fclose(out) != 0) {
+    fprintf(stderr, "error: cannot write %s\n", argv[1]);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,53 @@
+# Parses an adversarial schema on one thread, on several threads and
+# streamed, and fails unless all of them generate the same code. A broken
+# variant of the schema must give the same errors on one or several threads.
+#
+# Expects DATAGEN, MAKE_SCHEMA and WORK_DIR to be defined.
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+
+# Large enough for -j 4 to get four chunks of at least PARSE_CHUNK_MIN.
+set(schema_mb 24)
+set(jobs 4)
+
+function(run_datagen name schema expected_result)
+  execute_process(
+    COMMAND ${DATAGEN} ${ARGN} ${schema}
+    OUTPUT_FILE ${WORK_DIR}/${name}.out
+    ERROR_FILE ${WORK_DIR}/${name}.err
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL expected_result)
+    file(READ ${WORK_DIR}/${name}.err errors LIMIT 4096)
+    message(FATAL_ERROR
+            "datagen ${ARGN} exited with ${result}, expected "
+            "${expected_result}:\n${errors}")
+  endif()
+endfunction()
+
+function(expect_same a b)
+  execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/${a} ${WORK_DIR}/${b}
+    RESULT_VARIABLE different)
+  if(different)
+    message(FATAL_ERROR "${a} and ${b} differ, see ${WORK_DIR}")
+  endif()
+endfunction()
+
+set(valid ${WORK_DIR}/valid.data)
+execute_process(COMMAND ${MAKE_SCHEMA} ${valid} ${schema_mb}
+                COMMAND_ERROR_IS_FATAL ANY)
+run_datagen(valid_j1 ${valid} 0 -j 1)
+run_datagen(valid_jn ${valid} 0 -j ${jobs})
+run_datagen(valid_stream ${valid} 0 --stream)
+expect_same(valid_j1.out valid_jn.out)
+expect_same(valid_j1.out valid_stream.out)
+
+set(broken ${WORK_DIR}/broken.data)
+execute_process(COMMAND ${MAKE_SCHEMA} ${broken} ${schema_mb} broken
+                COMMAND_ERROR_IS_FATAL ANY)
+run_datagen(broken_j1 ${broken} 1 -j 1)
+run_datagen(broken_jn ${broken} 1 -j ${jobs})
+expect_same(broken_j1.err broken_jn.err)
+
+# Passed: the inputs and outputs are large, keep only a failed run's.
+file(REMOVE_RECURSE ${WORK_DIR})
@@ -0,0 +1,99 @@
+// Round-trips the generated serialize and hash code of tests/roundtrip.data:
+// packed structs (Vec3, Header), tables (Item) and tables of nested structs
+// (Entity, Squad).
+
+#include "roundtrip_types.h"
+#include <cstdio>
+#include <unordered_set>
+
+template <class T> static void check_roundtrip(Arena *arena, const T &value) {
+  str8 buffer = serialize(arena, value);
+  CHECK(buffer.len == serialized_size(value), "serialized_size disagrees");
+
+  T back{};
+  CHECK(deserialize(buffer, &back), "deserialize failed");
+  CHECK(back == value, "value changed in a round trip");
+  CHECK(hash(back) == hash(value), "hash changed in a round trip");
+  CHECK(std::hash<T>{}(back) == std::hash<T>{}(value),
+        "std::hash changed in a round trip");
+
+  // Every strict prefix lacks part of the size its header announces.
+  for (usize len = 0; len < buffer.len; len++) {
+    T partial{};
+    CHECK(!deserialize(str8_span(buffer, 0, len), &partial),
+          "accepted a %zu byte prefix of %zu", len, buffer.len);
+  }
+}
+
+static Entity make_entity(i32 seed) {
+  return {
+      .position = {f32(seed), -1.5f, 0.25f},
+      .item = {u8(seed), 0x0123456789ABCDEFull + u64(seed), 2.5, seed % 2 == 0},
+      .header = {0xCAFEu, Access::Read | Access::Execute, 3, u16(seed)},
+      .health = -seed,
+  };
+}
+
+int main() {
+  ArenaCreationInfo info{};
+  Arena *arena = arena_alloc(&info);
+  defer { arena_release(arena); };
+
+  Vec3 position = {1.0f, -2.0f, 3.5f};
+  Header header = {0xCAFEu, Access::Write, 7, 9};
+  Item item = {3, 42, 0.5, true};
+  Entity entity = make_entity(5);
+  Squad squad = {make_entity(1), make_entity(2), 2};
+
+  check_roundtrip(arena, position);
+  check_roundtrip(arena, header);
+  check_roundtrip(arena, item);
+  check_roundtrip(arena, entity);
+  check_roundtrip(arena, squad);
+
+  // Buffers carry their format, so a packed struct never reads a table and
+  // a table never reads a packed struct.
+  Item from_packed{};
+  CHECK(!deserialize(serialize(arena, position), &from_packed),
+        "a table read a packed buffer");
+  Vec3 from_table{};
+  CHECK(!deserialize(serialize(arena, item), &from_table),
+        "a packed struct read a table");
+
+  // An older writer of Header that stopped after `access`: the fields it
+  // lacked read as zero.
+  str8 old = serialize(arena, header);
+  usize old_size = sizeof(u32) + sizeof(Access);
+  le_store<u32>(old.data + 4, u32(old_size));
+  Header upgraded{};
+  CHECK(deserialize(str8_span(old, 0, PACKED_HEADER_SIZE + old_size),
+                    &upgraded),
+        "an older packed buffer was rejected");
+  CHECK(upgraded.magic == header.magic && upgraded.access == header.access &&
+            upgraded.version == 0 && upgraded.kind == 0,
+        "an older packed buffer read wrong values");
+
+  // Views read fields in place, nested structs as blobs.
+  EntityView view{{serialize(arena, entity)}};
+  CHECK(view.valid() && view.health() == entity.health, "EntityView failed");
+  ItemView item_view{{view.item()}};
+  CHECK(item_view.valid() && item_view.id() == entity.item.id &&
+            item_view.weight() == entity.item.weight,
+        "ItemView over a nested blob failed");
+
+  // 0.0 and -0.0 compare equal, so they must hash alike.
+  Vec3 zero = {0.0f, 0.0f, 0.0f};
+  Vec3 negative_zero = {-0.0f, 0.0f, -0.0f};
+  CHECK(zero == negative_zero && hash(zero) == hash(negative_zero),
+        "-0.0 hashes differently from 0.0");
+
+  std::unordered_set<Squad> squads;
+  squads.insert(squad);
+  squads.insert(Squad{make_entity(1), make_entity(2), 2});
+  squads.insert(Squad{make_entity(1), make_entity(3), 2});
+  CHECK(squads.size() == 2, "unordered_set<Squad> holds %zu squads",
+        squads.size());
+
+  printf("roundtrip: ok\n");
+  return 0;
+}